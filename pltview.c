@@ -3,19 +3,44 @@
  * Similar to ncview, using X11/Athena Widgets for GUI
  */
 
+#define _GNU_SOURCE  /* O_DIRECT */
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <ctype.h>
 #include <dirent.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)  /* Kernel headers older than 5.1 lack it */
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define FAB_HAVE_URING
+#endif
+#endif
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
 #include <math.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/Xos.h>
 #include <X11/Xatom.h>
 #include <X11/keysym.h>
+#include <X11/extensions/XShm.h>
 #include <X11/Intrinsic.h>
 #include <X11/StringDefs.h>
 #include <X11/Shell.h>
@@ -30,7 +55,7 @@
 #include <X11/Xaw/Viewport.h>
 
 #define MAX_VARS 128
-#define MAX_BOXES 1024
+#define MAX_BOXES 1024     /* Particle grids per level (AMR box tables grow as needed) */
 #define MAX_PATH 512
 #define MAX_LINE 1024
 #define MAX_TIMESTEPS 1024
@@ -44,13 +69,33 @@ typedef struct {
     long long offset;
 } Box;
 
+/* Box indices sorted by lower corner along each axis, so the boxes crossing a
+ * plane are found by binary search over [coord - max_extent + 1, coord] */
+typedef struct {
+    int *order[3];          /* Box indices sorted by lo[axis] */
+    int max_extent[3];      /* Largest box size along each axis */
+    int n;                  /* Number of boxes indexed */
+} BoxIndex;
+
+/* Per-box, per-component min/max from the end of Cell_H, box-major:
+ * min[box * n_comps + comp]. n_boxes is 0 when the file carried none. */
+typedef struct {
+    double *min;
+    double *max;
+    int n_comps;
+    int n_boxes;
+} BoxRanges;
+
 /* Per-level data storage for multi-level overlay rendering */
 typedef struct {
     int grid_dims[3];       /* Grid dimensions for this level */
     int level_lo[3];        /* Lower index bounds in level's coordinates */
     int level_hi[3];        /* Upper index bounds in level's coordinates */
-    Box boxes[MAX_BOXES];   /* Box definitions for this level */
+    Box *boxes;             /* Box definitions for this level */
     int n_boxes;            /* Number of boxes at this level */
+    int cap_boxes;          /* Allocated size of boxes */
+    BoxIndex box_index;     /* Plane lookup for boxes */
+    BoxRanges box_ranges;   /* Cell_H min/max per box and component */
     double *data;           /* Variable data for this level */
     int loaded;             /* Flag: 1 if data is loaded, 0 otherwise */
 } LevelData;
@@ -64,9 +109,13 @@ typedef struct {
     int grid_dims[3];
     int level_lo[3];    /* Current level's lower index bounds */
     int level_hi[3];    /* Current level's upper index bounds */
-    Box boxes[MAX_BOXES];
+    Box *boxes;
     int n_boxes;
+    int cap_boxes;
+    BoxIndex box_index;
+    BoxRanges box_ranges;
     double *data;  /* Current variable data */
+    struct PlaneIndex *plane_index;  /* Plane summaries of data, or NULL */
     int current_var;
     int slice_axis;
     int slice_idx;
@@ -148,6 +197,7 @@ typedef struct {
 
 /* SBM (Spectral Bin Microphysics) mode definitions */
 #define MAX_SBM_BINS 64
+#define SBM_READ_BATCH_MB 512  /* Bin volumes held at once while summing */
 #define SBM_BIN_INFO_FILE "bin_info.txt"
 
 /* SBM metric types */
@@ -216,7 +266,8 @@ unsigned long *pixel_data;
 size_t pixel_data_size = 0;
 int canvas_width = 800;
 int canvas_height = 600;
-Pixmap pixmap, colorbar_pixmap;
+Pixmap pixmap, colorbar_pixmap;  /* pixmap: backing store for the canvas */
+int pixmap_valid = 0;              /* pixmap holds a finished frame */
 XFontStruct *font;
 double current_vmin = 0, current_vmax = 1;
 
@@ -353,12 +404,23 @@ int detect_levels_for_path(const char *plotfile_dir);
 void show_level_warning(int level);
 int read_header(PlotfileData *pf);
 int read_cell_h(PlotfileData *pf);
+void free_box_tables(PlotfileData *pf);
+int variable_range_from_cell_h(PlotfileData *pf, int var_idx, int all_timesteps,
+                               double *vmin, double *vmax);
 int read_variable_data(PlotfileData *pf, int var_idx);
+void set_variable_cache_mb(long mb);
+void prefetch_neighbour_timesteps(PlotfileData *pf, int step);
+void prefetch_cancel(void);
+int read_variable_slice(PlotfileData *pf, int var_idx, int axis, int idx, double *slice);
+int read_variable_slices(PlotfileData *pf, const int *var_idxs, int n_vars,
+                         int axis, int idx, double **slices);
 void extract_slice(PlotfileData *pf, double *slice, int axis, int idx);
 void extract_slice_level(LevelData *ld, double *slice, int axis, int idx);
 /* Multi-level overlay functions */
 int read_cell_h_level(PlotfileData *pf, int level);
 int read_variable_data_level(PlotfileData *pf, int var_idx, int level);
+int read_variable_slice_level(PlotfileData *pf, int var_idx, int level, int axis, int idx,
+                              double *slice);
 int load_all_levels(PlotfileData *pf, int var_idx);
 void free_all_levels(PlotfileData *pf);
 void apply_colormap(double *data, int width, int height, 
@@ -380,6 +442,7 @@ void colorbar_button_callback(Widget w, XtPointer client_data, XtPointer call_da
 void colorbar_expose_callback(Widget w, XtPointer client_data, XtPointer call_data);
 void init_gui(PlotfileData *pf, int argc, char **argv);
 void render_slice(PlotfileData *pf);
+int pan_slice_from_cache(PlotfileData *pf);
 void update_info_label(PlotfileData *pf);
 void var_button_callback(Widget w, XtPointer client_data, XtPointer call_data);
 void axis_button_callback(Widget w, XtPointer client_data, XtPointer call_data);
@@ -423,10 +486,10 @@ void show_variable_selector(Widget w, XtPointer client_data, XtPointer call_data
 void variable_select_callback(Widget w, XtPointer client_data, XtPointer call_data);
 void variable_selector_close_callback(Widget w, XtPointer client_data, XtPointer call_data);
 void render_quiver_overlay(PlotfileData *pf);
-void draw_arrow(Display *dpy, Drawable win, GC graphics_gc, int x1, int y1, int x2, int y2);
 void extract_slice_from_data(double *data, PlotfileData *pf, double *slice, int axis, int idx);
 void update_layer_label(PlotfileData *pf);
 void canvas_expose_callback(Widget w, XtPointer client_data, XtPointer call_data);
+void canvas_repaint(int x, int y, int width, int height);
 void canvas_motion_handler(Widget w, XtPointer client_data, XEvent *event, Boolean *continue_dispatch);
 void canvas_button_handler(Widget w, XtPointer client_data, XEvent *event, Boolean *continue_dispatch);
 void canvas_button_release_handler(Widget w, XtPointer client_data, XEvent *event, Boolean *continue_dispatch);
@@ -1009,6 +1072,11 @@ void switch_timestep(PlotfileData *pf, int new_timestep) {
     if (new_timestep < 0 || new_timestep >= n_timesteps) return;
 
     zoom_reset();
+    /* Stepping direction for the prefetcher; a wrap-around counts as one step */
+    int step = new_timestep - current_timestep;
+    if (step == n_timesteps - 1) step = -1;
+    else if (step == 1 - n_timesteps) step = 1;
+    else if (step != 1 && step != -1) step = 0;
     current_timestep = new_timestep;
 
     /* Update plotfile directory */
@@ -1062,6 +1130,8 @@ void switch_timestep(PlotfileData *pf, int new_timestep) {
     update_layer_label(pf);
     update_info_label(pf);
     render_slice(pf);
+
+    prefetch_neighbour_timesteps(pf, step);
 }
 
 /* Update time step label */
@@ -1387,26 +1457,260 @@ int read_header(PlotfileData *pf) {
     return 0;
 }
 
-/* Read Cell_H to get box layout and FabOnDisk mapping */
-int read_cell_h(PlotfileData *pf) {
+/* ========== Box Tables ========== */
+
+/* Grow a box table to hold at least n boxes */
+static int box_table_reserve(Box **boxes, int *cap, int n) {
+    if (n <= *cap) return 0;
+    int new_cap = *cap > 0 ? *cap : 256;
+    while (new_cap < n) new_cap *= 2;
+    Box *tmp = (Box *)realloc(*boxes, new_cap * sizeof(Box));
+    if (!tmp) {
+        fprintf(stderr, "Error: Cannot allocate box table (%d boxes)\n", n);
+        return -1;
+    }
+    *boxes = tmp;
+    *cap = new_cap;
+    return 0;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    unsigned long long x = *(const unsigned long long *)a;
+    unsigned long long y = *(const unsigned long long *)b;
+    return (x > y) - (x < y);
+}
+
+static void box_index_free(BoxIndex *index) {
+    int a;
+    for (a = 0; a < 3; a++) {
+        free(index->order[a]);
+        index->order[a] = NULL;
+        index->max_extent[a] = 0;
+    }
+    index->n = 0;
+}
+
+/* (Re)build the per-axis sorted index for a box table */
+static void box_index_build(BoxIndex *index, const Box *boxes, int n_boxes) {
+    int a, b;
+
+    box_index_free(index);
+    if (n_boxes <= 0) return;
+
+    unsigned long long *keys = (unsigned long long *)malloc(n_boxes * sizeof(unsigned long long));
+    if (!keys) return;
+
+    for (a = 0; a < 3; a++) {
+        index->order[a] = (int *)malloc(n_boxes * sizeof(int));
+        if (!index->order[a]) {
+            free(keys);
+            box_index_free(index);
+            return;
+        }
+        /* Sort (lo, box) pairs packed into one key; lo is biased to sort as unsigned */
+        for (b = 0; b < n_boxes; b++) {
+            unsigned long long lo = (unsigned long long)((long long)boxes[b].lo[a] + 0x80000000LL);
+            keys[b] = (lo << 32) | (unsigned int)b;
+            int extent = boxes[b].hi[a] - boxes[b].lo[a] + 1;
+            if (extent > index->max_extent[a]) index->max_extent[a] = extent;
+        }
+        qsort(keys, n_boxes, sizeof(unsigned long long), compare_u64);
+        for (b = 0; b < n_boxes; b++) {
+            index->order[a][b] = (int)(keys[b] & 0xFFFFFFFFu);
+        }
+    }
+    index->n = n_boxes;
+    free(keys);
+}
+
+/* Collect the boxes with lo[axis] <= coord <= hi[axis] into hits (room for
+ * n_boxes entries). Falls back to a scan if the index is out of date. */
+static int boxes_on_plane(const Box *boxes, int n_boxes, const BoxIndex *index,
+                          int axis, int coord, int *hits) {
+    int n_hits = 0;
+    int b;
+
+    if (!index || index->n != n_boxes || !index->order[axis]) {
+        for (b = 0; b < n_boxes; b++) {
+            if (coord >= boxes[b].lo[axis] && coord <= boxes[b].hi[axis]) hits[n_hits++] = b;
+        }
+        return n_hits;
+    }
+
+    const int *order = index->order[axis];
+    int first_lo = coord - index->max_extent[axis] + 1;
+    int lo = 0, hi = n_boxes;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (boxes[order[mid]].lo[axis] < first_lo) lo = mid + 1;
+        else hi = mid;
+    }
+    for (b = lo; b < n_boxes && boxes[order[b]].lo[axis] <= coord; b++) {
+        if (boxes[order[b]].hi[axis] >= coord) hits[n_hits++] = order[b];
+    }
+    return n_hits;
+}
+
+/* Mark the cells of a (width x height) slice at slice_coord along axis that
+ * lie inside a box. Cells in gaps between non-contiguous boxes stay 0. */
+static unsigned char *build_box_mask(const Box *boxes, int n_boxes, const BoxIndex *index,
+                                     const int level_lo[3], int axis, int slice_coord,
+                                     int width, int height) {
+    unsigned char *mask = (unsigned char *)calloc((size_t)width * height, 1);
+    int *hits = (int *)malloc((n_boxes > 0 ? n_boxes : 1) * sizeof(int));
+    int dim_x, dim_y, h;
+
+    if (!mask || !hits) {
+        free(hits);
+        return mask;
+    }
+    if (axis == 2) { dim_x = 0; dim_y = 1; }
+    else if (axis == 1) { dim_x = 0; dim_y = 2; }
+    else { dim_x = 1; dim_y = 2; }
+
+    int n_hits = boxes_on_plane(boxes, n_boxes, index, axis, slice_coord, hits);
+    for (h = 0; h < n_hits; h++) {
+        const Box *box = &boxes[hits[h]];
+        int mi_lo = box->lo[dim_x] - level_lo[dim_x];
+        int mi_hi = box->hi[dim_x] - level_lo[dim_x];
+        int mj_lo = box->lo[dim_y] - level_lo[dim_y];
+        int mj_hi = box->hi[dim_y] - level_lo[dim_y];
+        if (mi_lo < 0) mi_lo = 0;
+        if (mj_lo < 0) mj_lo = 0;
+        if (mi_hi >= width) mi_hi = width - 1;
+        if (mj_hi >= height) mj_hi = height - 1;
+        for (int mj = mj_lo; mj <= mj_hi; mj++) {
+            if (mi_hi >= mi_lo) memset(&mask[(size_t)mj * width + mi_lo], 1, mi_hi - mi_lo + 1);
+        }
+    }
+    free(hits);
+    return mask;
+}
+
+static void box_ranges_free(BoxRanges *ranges) {
+    free(ranges->min);
+    free(ranges->max);
+    memset(ranges, 0, sizeof(*ranges));
+}
+
+/* Size ranges for n_boxes x n_comps values; the contents are undefined */
+static int box_ranges_alloc(BoxRanges *ranges, int n_boxes, int n_comps) {
+    size_t count = (size_t)n_boxes * n_comps;
+    box_ranges_free(ranges);
+    ranges->min = (double *)malloc((count > 0 ? count : 1) * sizeof(double));
+    ranges->max = (double *)malloc((count > 0 ? count : 1) * sizeof(double));
+    if (!ranges->min || !ranges->max) {
+        box_ranges_free(ranges);
+        return -1;
+    }
+    ranges->n_boxes = n_boxes;
+    ranges->n_comps = n_comps;
+    return 0;
+}
+
+static int box_ranges_copy(BoxRanges *dst, const BoxRanges *src) {
+    size_t count = (size_t)src->n_boxes * src->n_comps;
+    if (src->n_boxes <= 0) {
+        box_ranges_free(dst);
+        return 0;
+    }
+    if (box_ranges_alloc(dst, src->n_boxes, src->n_comps) < 0) return -1;
+    memcpy(dst->min, src->min, count * sizeof(double));
+    memcpy(dst->max, src->max, count * sizeof(double));
+    return 0;
+}
+
+/* A box whose Cell_H range is exactly [0, 0] holds only zeros, which is
+ * what the zero-filled read destinations already contain */
+static inline int box_range_is_zero(const BoxRanges *ranges, int box, int comp) {
+    size_t i;
+    if (!ranges || box >= ranges->n_boxes || comp >= ranges->n_comps) return 0;
+    i = (size_t)box * ranges->n_comps + comp;
+    return ranges->min[i] == 0.0 && ranges->max[i] == 0.0;
+}
+
+/* Widen [*vmin, *vmax] by the range of component comp over all boxes.
+ * Returns 0 if the table has no range for comp. */
+static int box_ranges_merge(const BoxRanges *ranges, int comp, double *vmin, double *vmax) {
+    int b, found = 0;
+    if (comp < 0 || comp >= ranges->n_comps) return 0;
+    for (b = 0; b < ranges->n_boxes; b++) {
+        size_t i = (size_t)b * ranges->n_comps + comp;
+        if (!isfinite(ranges->min[i]) || !isfinite(ranges->max[i])) continue;
+        if (ranges->min[i] < *vmin) *vmin = ranges->min[i];
+        if (ranges->max[i] > *vmax) *vmax = ranges->max[i];
+        found = 1;
+    }
+    return found;
+}
+
+/* Release the box tables of the current level and all overlay levels */
+void free_box_tables(PlotfileData *pf) {
+    int level;
+    free(pf->boxes);
+    pf->boxes = NULL;
+    pf->n_boxes = pf->cap_boxes = 0;
+    box_index_free(&pf->box_index);
+    box_ranges_free(&pf->box_ranges);
+    for (level = 0; level < MAX_LEVELS; level++) {
+        LevelData *ld = &pf->levels[level];
+        free(ld->boxes);
+        ld->boxes = NULL;
+        ld->n_boxes = ld->cap_boxes = 0;
+        box_index_free(&ld->box_index);
+        box_ranges_free(&ld->box_ranges);
+    }
+}
+
+/* ========== Cell_H Box Table Cache ========== */
+
+/* Parsed Cell_H box tables, keyed by path (i.e. timestep and level) and
+ * validated against the file's mtime and size, so revisiting a level or
+ * timestep skips the text parse entirely. */
+#define CELL_H_CACHE_SIZE 64
+
+typedef struct {
     char path[MAX_PATH];
+    time_t mtime;
+    off_t size;
+    int ndim;
+    Box *boxes;
+    int n_boxes;
+    int level_lo[3];
+    int level_hi[3];
+    BoxRanges ranges;
+    unsigned long last_used;
+} CellHCacheEntry;
+
+static CellHCacheEntry cell_h_cache[CELL_H_CACHE_SIZE];
+static unsigned long cell_h_cache_clock = 0;
+static pthread_mutex_t cell_h_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Parse a Cell_H file into a growable box table, the level bounds and, if
+ * ranges is given, the per-box min/max arrays that follow the FabOnDisk
+ * lines */
+static int parse_cell_h_file(const char *path, int ndim, Box **boxes, int *cap_boxes,
+                             int *n_boxes, int level_lo[3], int level_hi[3],
+                             BoxRanges *ranges) {
     char line[MAX_LINE];
     FILE *fp;
-    int i;
-    
-    snprintf(path, MAX_PATH, "%s/Level_%d/Cell_H", pf->plotfile_dir, pf->current_level);
+    int i, nb, nc;
+    int n_range_sections = 0;
+
     fp = fopen(path, "r");
     if (!fp) {
         fprintf(stderr, "Error: Cannot open %s\n", path);
         return -1;
     }
-    
-    /* Reset grid dimensions for this level */
-    int level_lo[3] = {0, 0, 0};
-    int level_hi[3] = {0, 0, 0};
+
     int found_domain = 0;
-    pf->n_boxes = 0;
-    
+    for (i = 0; i < 3; i++) {
+        level_lo[i] = 0;
+        level_hi[i] = 0;
+    }
+    *n_boxes = 0;
+    if (ranges) box_ranges_free(ranges);
+
     /* Skip first few lines until we find box definitions */
     int box_count = 0;
     while (fgets(line, MAX_LINE, fp)) {
@@ -1414,38 +1718,42 @@ int read_cell_h(PlotfileData *pf) {
             /* Parse box: ((lo_x,lo_y,lo_z) (hi_x,hi_y,hi_z) ...) */
             char *p = line + 2;
             int lo[3], hi[3];
-            for (i = 0; i < pf->ndim; i++) {
+            if (box_table_reserve(boxes, cap_boxes, box_count + 1) < 0) break;
+            memset(&(*boxes)[box_count], 0, sizeof(Box));
+            for (i = 0; i < ndim; i++) {
                 while (*p && !isdigit(*p) && *p != '-') p++;
                 lo[i] = atoi(p);
-                pf->boxes[box_count].lo[i] = lo[i];
+                (*boxes)[box_count].lo[i] = lo[i];
                 while (*p && (isdigit(*p) || *p == '-')) p++;
             }
-            for (i = 0; i < pf->ndim; i++) {
+            for (i = 0; i < ndim; i++) {
                 while (*p && !isdigit(*p) && *p != '-') p++;
                 hi[i] = atoi(p);
-                pf->boxes[box_count].hi[i] = hi[i];
+                (*boxes)[box_count].hi[i] = hi[i];
                 while (*p && (isdigit(*p) || *p == '-')) p++;
             }
-            
+
             /* Track overall domain bounds */
             if (!found_domain) {
-                for (i = 0; i < pf->ndim; i++) {
+                for (i = 0; i < ndim; i++) {
                     level_lo[i] = lo[i];
                     level_hi[i] = hi[i];
                 }
                 found_domain = 1;
             } else {
-                for (i = 0; i < pf->ndim; i++) {
+                for (i = 0; i < ndim; i++) {
                     if (lo[i] < level_lo[i]) level_lo[i] = lo[i];
                     if (hi[i] > level_hi[i]) level_hi[i] = hi[i];
                 }
             }
-            
+
             box_count++;
         } else if (strncmp(line, "FabOnDisk:", 10) == 0) {
             /* Parse FabOnDisk: Cell_D_XXXXX offset */
             char *p = strchr(line, ':');
             if (p) {
+                if (box_table_reserve(boxes, cap_boxes, *n_boxes + 1) < 0) break;
+                Box *box = &(*boxes)[*n_boxes];
                 p++;
                 while (*p == ' ') p++;
                 char *end = strchr(p, ' ');
@@ -1455,21 +1763,142 @@ int read_cell_h(PlotfileData *pf) {
                 }
                 char *line_end = strchr(p, '\n');
                 if (line_end) *line_end = '\0';
-                strncpy(pf->boxes[pf->n_boxes].filename, p, 63);
-                pf->boxes[pf->n_boxes].filename[63] = '\0';
-                pf->boxes[pf->n_boxes].offset = 0;
+                strncpy(box->filename, p, 63);
+                box->filename[63] = '\0';
+                box->offset = 0;
                 if (end) {
                     while (*end == ' ') end++;
                     if (*end) {
-                        pf->boxes[pf->n_boxes].offset = strtoll(end, NULL, 10);
+                        box->offset = strtoll(end, NULL, 10);
                     }
                 }
-                pf->n_boxes++;
+                (*n_boxes)++;
+            }
+        } else if (ranges && *n_boxes > 0 && n_range_sections < 2 &&
+                   sscanf(line, "%d,%d", &nb, &nc) == 2 && nb == *n_boxes && nc > 0) {
+            /* "n_boxes,n_comps" then one row of n_comps values per box:
+             * first the minima, then the maxima */
+            size_t count = (size_t)nb * nc, k;
+            if (n_range_sections == 0 && box_ranges_alloc(ranges, nb, nc) < 0) break;
+            if (nc != ranges->n_comps) break;
+            double *vals = n_range_sections == 0 ? ranges->min : ranges->max;
+            for (k = 0; k < count; k++) {
+                if (fscanf(fp, " %lf ,", &vals[k]) != 1) break;
             }
+            if (k < count) break;
+            n_range_sections++;
         }
     }
-    
+    if (ranges && n_range_sections < 2) box_ranges_free(ranges);
+
     fclose(fp);
+    return 0;
+}
+
+/* Fill boxes/n_boxes and the level bounds for a Cell_H file, from the cache
+ * when the file is unchanged since it was last parsed */
+static int load_cell_h_locked(const char *path, int ndim, Box **boxes, int *cap_boxes,
+                              int *n_boxes, int level_lo[3], int level_hi[3],
+                              BoxRanges *ranges) {
+    struct stat st;
+    int e, slot;
+
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "Error: Cannot open %s\n", path);
+        return -1;
+    }
+
+    for (e = 0; e < CELL_H_CACHE_SIZE; e++) {
+        CellHCacheEntry *ce = &cell_h_cache[e];
+        if (!ce->boxes || strcmp(ce->path, path) != 0) continue;
+        if (ce->ndim == ndim && ce->mtime == st.st_mtime && ce->size == st.st_size) {
+            if (box_table_reserve(boxes, cap_boxes, ce->n_boxes) < 0) return -1;
+            memcpy(*boxes, ce->boxes, ce->n_boxes * sizeof(Box));
+            *n_boxes = ce->n_boxes;
+            memcpy(level_lo, ce->level_lo, sizeof(ce->level_lo));
+            memcpy(level_hi, ce->level_hi, sizeof(ce->level_hi));
+            if (ranges && box_ranges_copy(ranges, &ce->ranges) < 0) return -1;
+            ce->last_used = ++cell_h_cache_clock;
+            return 0;
+        }
+        break;  /* Stale entry for this path: reparse into the same slot */
+    }
+
+    /* Otherwise take an empty slot, or the least recently used one */
+    slot = e;
+    if (slot == CELL_H_CACHE_SIZE) {
+        slot = 0;
+        for (e = 0; e < CELL_H_CACHE_SIZE; e++) {
+            if (!cell_h_cache[e].boxes) { slot = e; break; }
+            if (cell_h_cache[e].last_used < cell_h_cache[slot].last_used) slot = e;
+        }
+    }
+
+    /* Always parse the ranges so the cached entry serves every caller */
+    BoxRanges parsed;
+    memset(&parsed, 0, sizeof(parsed));
+    if (parse_cell_h_file(path, ndim, boxes, cap_boxes, n_boxes, level_lo, level_hi,
+                          &parsed) < 0) {
+        return -1;
+    }
+    if (ranges && box_ranges_copy(ranges, &parsed) < 0) {
+        box_ranges_free(&parsed);
+        return -1;
+    }
+
+    CellHCacheEntry *ce = &cell_h_cache[slot];
+    Box *copy = (Box *)malloc((*n_boxes > 0 ? *n_boxes : 1) * sizeof(Box));
+    if (!copy) {
+        box_ranges_free(&parsed);
+        return 0;
+    }
+    free(ce->boxes);
+    box_ranges_free(&ce->ranges);
+    strncpy(ce->path, path, MAX_PATH - 1);
+    ce->path[MAX_PATH - 1] = '\0';
+    ce->mtime = st.st_mtime;
+    ce->size = st.st_size;
+    ce->ndim = ndim;
+    memcpy(copy, *boxes, *n_boxes * sizeof(Box));
+    ce->boxes = copy;
+    ce->n_boxes = *n_boxes;
+    memcpy(ce->level_lo, level_lo, sizeof(ce->level_lo));
+    memcpy(ce->level_hi, level_hi, sizeof(ce->level_hi));
+    ce->ranges = parsed;
+    ce->last_used = ++cell_h_cache_clock;
+    return 0;
+}
+
+/* The prefetch thread parses Cell_H files too, so the cache is serialized */
+static int load_cell_h(const char *path, int ndim, Box **boxes, int *cap_boxes, int *n_boxes,
+                       int level_lo[3], int level_hi[3], BoxRanges *ranges) {
+    int ret;
+    pthread_mutex_lock(&cell_h_cache_lock);
+    ret = load_cell_h_locked(path, ndim, boxes, cap_boxes, n_boxes, level_lo, level_hi, ranges);
+    pthread_mutex_unlock(&cell_h_cache_lock);
+    return ret;
+}
+
+/* Format the path of a level directory, or of the file name inside it, into
+ * path (MAX_PATH bytes). Returns -1 if the path does not fit. */
+static int level_path(char *path, const char *plotfile_dir, int level, const char *name) {
+    int n = name ? snprintf(path, MAX_PATH, "%s/Level_%d/%s", plotfile_dir, level, name)
+                 : snprintf(path, MAX_PATH, "%s/Level_%d", plotfile_dir, level);
+    return (n >= 0 && n < MAX_PATH) ? 0 : -1;
+}
+
+/* Read Cell_H to get box layout and FabOnDisk mapping */
+int read_cell_h(PlotfileData *pf) {
+    char path[MAX_PATH];
+    int level_lo[3], level_hi[3];
+    int i;
+
+    if (level_path(path, pf->plotfile_dir, pf->current_level, "Cell_H") < 0) return -1;
+    if (load_cell_h(path, pf->ndim, &pf->boxes, &pf->cap_boxes, &pf->n_boxes,
+                    level_lo, level_hi, &pf->box_ranges) < 0) {
+        return -1;
+    }
+    box_index_build(&pf->box_index, pf->boxes, pf->n_boxes);
 
     /* Update grid dimensions and level bounds */
     for (i = 0; i < pf->ndim; i++) {
@@ -1487,265 +1916,2152 @@ int read_cell_h(PlotfileData *pf) {
     return 0;
 }
 
-/* Read variable data from all boxes */
-int read_variable_data(PlotfileData *pf, int var_idx) {
+/* Range of a variable on the current level from the Cell_H min/max arrays,
+ * without reading any data. With all_timesteps, the range covers that level
+ * in every timestep (Cell_H tables come from the cache after the first
+ * pass). Returns -1 if no Cell_H carried a range for the variable. */
+int variable_range_from_cell_h(PlotfileData *pf, int var_idx, int all_timesteps,
+                               double *vmin, double *vmax) {
     char path[MAX_PATH];
-    FILE *fp;
-    int box_idx, i, j, k;
-    size_t total_size = pf->grid_dims[0] * pf->grid_dims[1] * pf->grid_dims[2];
-    
-    /* Allocate data array (Z, Y, X ordering) */
-    if (pf->data) free(pf->data);
-    pf->data = (double *)calloc(total_size, sizeof(double));
-    
-    /* Read each box */
-    for (box_idx = 0; box_idx < pf->n_boxes; box_idx++) {
-        Box *box = &pf->boxes[box_idx];
-        int box_dims[3];
-        for (i = 0; i < 3; i++) {
-            box_dims[i] = box->hi[i] - box->lo[i] + 1;
+    struct stat st;
+    int t, found = 0;
+
+    *vmin = INFINITY;
+    *vmax = -INFINITY;
+    if (!all_timesteps || n_timesteps == 0) {
+        found = box_ranges_merge(&pf->box_ranges, var_idx, vmin, vmax);
+        return found ? 0 : -1;
+    }
+
+    Box *boxes = NULL;
+    BoxRanges ranges;
+    int cap_boxes = 0, n_boxes, level_lo[3], level_hi[3];
+    memset(&ranges, 0, sizeof(ranges));
+    for (t = 0; t < n_timesteps; t++) {
+        if (level_path(path, timestep_paths[t], pf->current_level, "Cell_H") < 0) continue;
+        if (stat(path, &st) != 0) continue;  /* Level not present at this timestep */
+        if (load_cell_h(path, pf->ndim, &boxes, &cap_boxes, &n_boxes,
+                        level_lo, level_hi, &ranges) < 0) {
+            continue;
         }
-        size_t box_size = box_dims[0] * box_dims[1] * box_dims[2];
-        
-        snprintf(path, MAX_PATH, "%s/Level_%d/%s", pf->plotfile_dir, pf->current_level, box->filename);
-        fp = fopen(path, "rb");
-        if (!fp) continue;
-        
-        /* Seek to FAB header offset if provided */
-        if (box->offset > 0) {
-            fseeko(fp, (off_t)box->offset, SEEK_SET);
+        found |= box_ranges_merge(&ranges, var_idx, vmin, vmax);
+    }
+    free(boxes);
+    box_ranges_free(&ranges);
+    return found ? 0 : -1;
+}
+
+/* ========== Worker Pool ========== */
+
+/* A small persistent pool for parallel-for style work. The calling thread
+ * takes items too, so a pool of N threads uses N-1 workers. Size comes from
+ * PLTVIEW_THREADS or the number of online CPUs. */
+typedef void (*PoolTaskFn)(void *ctx, int item);
+
+#define MAX_POOL_THREADS 64
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t work_cv;
+    pthread_cond_t done_cv;
+    pthread_t threads[MAX_POOL_THREADS];
+    int n_workers;
+    int initialized;
+    int busy;                   /* a caller currently owns the pool */
+    PoolTaskFn fn;
+    void *ctx;
+    int n_items;
+    int next_item;
+    int n_done;
+    unsigned long generation;
+} worker_pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+/* Take and run items until none are left. Called with the lock held. */
+static void pool_drain_locked(void) {
+    while (worker_pool.next_item < worker_pool.n_items) {
+        int item = worker_pool.next_item++;
+        pthread_mutex_unlock(&worker_pool.lock);
+        worker_pool.fn(worker_pool.ctx, item);
+        pthread_mutex_lock(&worker_pool.lock);
+        if (++worker_pool.n_done == worker_pool.n_items) {
+            pthread_cond_broadcast(&worker_pool.done_cv);
         }
+    }
+}
 
-        /* Skip FAB header (read until newline) */
-        int c;
-        while ((c = fgetc(fp)) != EOF && c != '\n');
+static void *pool_worker_main(void *arg) {
+    unsigned long seen = 0;
+    (void)arg;
 
-        /* Skip to variable data */
-        fseeko(fp, (off_t)(var_idx * box_size * sizeof(double)), SEEK_CUR);
-        
-        /* Read box data */
-        double *box_data = (double *)malloc(box_size * sizeof(double));
-        fread(box_data, sizeof(double), box_size, fp);
-        fclose(fp);
-        
-        /* Insert into global array (Fortran order -> C order) */
-        /* Fortran order: X varies fastest */
-        /* Use relative indices by subtracting level_lo to handle non-zero level origins */
-        size_t idx = 0;
-        for (k = 0; k < box_dims[2]; k++) {
-            for (j = 0; j < box_dims[1]; j++) {
-                for (i = 0; i < box_dims[0]; i++) {
-                    int gx = box->lo[0] + i - pf->level_lo[0];
-                    int gy = box->lo[1] + j - pf->level_lo[1];
-                    int gz = box->lo[2] + k - pf->level_lo[2];
-                    /* Global array: data[z][y][x] */
-                    size_t gidx = gz * pf->grid_dims[1] * pf->grid_dims[0] +
-                                  gy * pf->grid_dims[0] + gx;
-                    pf->data[gidx] = box_data[idx++];
-                }
-            }
+    pthread_mutex_lock(&worker_pool.lock);
+    for (;;) {
+        while (worker_pool.generation == seen) {
+            pthread_cond_wait(&worker_pool.work_cv, &worker_pool.lock);
         }
-        
-        free(box_data);
+        seen = worker_pool.generation;
+        pool_drain_locked();
     }
-    
-    printf("Loaded variable: %s\n", pf->variables[var_idx]);
-    return 0;
+    return NULL;
 }
 
-/* ========== Multi-Level Overlay Functions ========== */
+static int pool_thread_count(void) {
+    const char *env = getenv("PLTVIEW_THREADS");
+    long n = env ? atol(env) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) n = 1;
+    if (n > MAX_POOL_THREADS) n = MAX_POOL_THREADS;
+    return (int)n;
+}
 
-/* Read Cell_H for a specific level into LevelData */
-int read_cell_h_level(PlotfileData *pf, int level) {
-    char path[MAX_PATH];
-    char line[MAX_LINE];
-    FILE *fp;
+/* Start workers on first use. Called with the lock held. */
+static void pool_init_locked(void) {
+    int i, n = pool_thread_count() - 1;
+
+    worker_pool.initialized = 1;
+    for (i = 0; i < n; i++) {
+        if (pthread_create(&worker_pool.threads[i], NULL, pool_worker_main, NULL) != 0) break;
+        pthread_detach(worker_pool.threads[i]);
+        worker_pool.n_workers++;
+    }
+}
+
+/* Run fn(ctx, 0..n_items-1) across the pool and wait for all items.
+ * Falls back to a serial loop when there are no workers or the pool is
+ * already in use (e.g. a nested call). */
+static void pool_run(PoolTaskFn fn, void *ctx, int n_items) {
     int i;
-    LevelData *ld = &pf->levels[level];
 
-    snprintf(path, MAX_PATH, "%s/Level_%d/Cell_H", pf->plotfile_dir, level);
-    fp = fopen(path, "r");
-    if (!fp) {
-        fprintf(stderr, "Error: Cannot open %s\n", path);
-        return -1;
+    if (n_items <= 0) return;
+
+    pthread_mutex_lock(&worker_pool.lock);
+    if (!worker_pool.initialized) pool_init_locked();
+    if (worker_pool.n_workers == 0 || worker_pool.busy || n_items == 1) {
+        pthread_mutex_unlock(&worker_pool.lock);
+        for (i = 0; i < n_items; i++) fn(ctx, i);
+        return;
     }
 
-    /* Reset level data */
-    int level_lo[3] = {0, 0, 0};
-    int level_hi[3] = {0, 0, 0};
-    int found_domain = 0;
-    ld->n_boxes = 0;
+    worker_pool.busy = 1;
+    worker_pool.fn = fn;
+    worker_pool.ctx = ctx;
+    worker_pool.n_items = n_items;
+    worker_pool.next_item = 0;
+    worker_pool.n_done = 0;
+    worker_pool.generation++;
+    pthread_cond_broadcast(&worker_pool.work_cv);
 
-    /* Parse box definitions and FabOnDisk entries */
-    int box_count = 0;
-    while (fgets(line, MAX_LINE, fp)) {
-        if (strncmp(line, "((", 2) == 0) {
-            /* Parse box: ((lo_x,lo_y,lo_z) (hi_x,hi_y,hi_z) ...) */
-            char *p = line + 2;
-            int lo[3], hi[3];
-            for (i = 0; i < pf->ndim; i++) {
-                while (*p && !isdigit(*p) && *p != '-') p++;
-                lo[i] = atoi(p);
-                ld->boxes[box_count].lo[i] = lo[i];
-                while (*p && (isdigit(*p) || *p == '-')) p++;
-            }
-            for (i = 0; i < pf->ndim; i++) {
-                while (*p && !isdigit(*p) && *p != '-') p++;
-                hi[i] = atoi(p);
-                ld->boxes[box_count].hi[i] = hi[i];
-                while (*p && (isdigit(*p) || *p == '-')) p++;
-            }
+    pool_drain_locked();
+    while (worker_pool.n_done < worker_pool.n_items) {
+        pthread_cond_wait(&worker_pool.done_cv, &worker_pool.lock);
+    }
+    worker_pool.busy = 0;
+    pthread_mutex_unlock(&worker_pool.lock);
+}
 
-            /* Track overall domain bounds */
-            if (!found_domain) {
-                for (i = 0; i < pf->ndim; i++) {
-                    level_lo[i] = lo[i];
-                    level_hi[i] = hi[i];
-                }
-                found_domain = 1;
-            } else {
-                for (i = 0; i < pf->ndim; i++) {
-                    if (lo[i] < level_lo[i]) level_lo[i] = lo[i];
-                    if (hi[i] > level_hi[i]) level_hi[i] = hi[i];
-                }
+/* ========== Streaming Moments ========== */
+
+/* Count, min, max, mean and the central moment sums M2..M4 of a sample,
+ * in one pass over memory: each block of MOMENTS_BLOCK values is centred
+ * on its own mean while it sits in L1 and folded into the running result
+ * with the pairwise update of Chan et al. / Pebay. Nothing is computed as
+ * E[x^2] - E[x]^2, so small fluctuations about a large mean (pressure
+ * perturbations) keep their digits, and partial results from different
+ * threads merge exactly. */
+#define MOMENTS_BLOCK 512
+#define MOMENTS_CHUNK ((size_t)1 << 20)    /* Values per parallel work item */
+
+typedef struct {
+    double n;                   /* Count (double: it enters the merge formulas) */
+    double min, max;
+    double mean;
+    double m2, m3, m4;          /* Sums of (x - mean)^2, ^3, ^4 */
+} Moments;
+
+static void moments_init(Moments *m) {
+    m->n = 0.0;
+    m->min = INFINITY;
+    m->max = -INFINITY;
+    m->mean = m->m2 = m->m3 = m->m4 = 0.0;
+}
+
+/* Fold b into a */
+static void moments_merge(Moments *a, const Moments *b) {
+    double na = a->n, nb = b->n;
+
+    if (nb == 0.0) return;
+    if (na == 0.0) {
+        *a = *b;
+        return;
+    }
+    double n = na + nb;
+    double d = b->mean - a->mean;
+    double dn = d / n, dn2 = dn * dn;
+    double nab = na * nb;
+
+    a->m4 += b->m4 + d * dn * dn2 * nab * (na * na - nab + nb * nb) +
+             6.0 * dn2 * (na * na * b->m2 + nb * nb * a->m2) +
+             4.0 * dn * (na * b->m3 - nb * a->m3);
+    a->m3 += b->m3 + d * dn2 * nab * (na - nb) + 3.0 * dn * (na * b->m2 - nb * a->m2);
+    a->m2 += b->m2 + d * dn * nab;
+    a->mean += nb * dn;
+    a->n = n;
+    if (b->min < a->min) a->min = b->min;
+    if (b->max > a->max) a->max = b->max;
+}
+
+/* Moments of one block (n <= MOMENTS_BLOCK): sum, min and max, then the
+ * central sums about the block mean, both over data already in cache */
+static void moments_block(const double *x, size_t n, Moments *b) {
+    double sum = 0.0, lo = INFINITY, hi = -INFINITY;
+    double s2 = 0.0, s3 = 0.0, s4 = 0.0;
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    __m256d vsum = _mm256_setzero_pd();
+    __m256d vlo = _mm256_set1_pd(INFINITY), vhi = _mm256_set1_pd(-INFINITY);
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(x + i);
+        vsum = _mm256_add_pd(vsum, v);
+        vlo = _mm256_min_pd(vlo, v);
+        vhi = _mm256_max_pd(vhi, v);
+    }
+    double lane[4];
+    _mm256_storeu_pd(lane, vsum);
+    sum = (lane[0] + lane[1]) + (lane[2] + lane[3]);
+    _mm256_storeu_pd(lane, vlo);
+    lo = fmin(fmin(lane[0], lane[1]), fmin(lane[2], lane[3]));
+    _mm256_storeu_pd(lane, vhi);
+    hi = fmax(fmax(lane[0], lane[1]), fmax(lane[2], lane[3]));
+#endif
+    for (; i < n; i++) {
+        sum += x[i];
+        if (x[i] < lo) lo = x[i];
+        if (x[i] > hi) hi = x[i];
+    }
+    double mean = sum / n;
+
+    i = 0;
+#if defined(__AVX2__)
+    __m256d vmean = _mm256_set1_pd(mean);
+    __m256d v2 = _mm256_setzero_pd(), v3 = _mm256_setzero_pd(), v4 = _mm256_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        __m256d d = _mm256_sub_pd(_mm256_loadu_pd(x + i), vmean);
+        __m256d dd = _mm256_mul_pd(d, d);
+        v2 = _mm256_add_pd(v2, dd);
+        v3 = _mm256_add_pd(v3, _mm256_mul_pd(dd, d));
+        v4 = _mm256_add_pd(v4, _mm256_mul_pd(dd, dd));
+    }
+    _mm256_storeu_pd(lane, v2);
+    s2 = (lane[0] + lane[1]) + (lane[2] + lane[3]);
+    _mm256_storeu_pd(lane, v3);
+    s3 = (lane[0] + lane[1]) + (lane[2] + lane[3]);
+    _mm256_storeu_pd(lane, v4);
+    s4 = (lane[0] + lane[1]) + (lane[2] + lane[3]);
+#endif
+    for (; i < n; i++) {
+        double d = x[i] - mean, dd = d * d;
+        s2 += dd;
+        s3 += dd * d;
+        s4 += dd * dd;
+    }
+
+    b->n = (double)n;
+    b->min = lo;
+    b->max = hi;
+    b->mean = mean;
+    b->m2 = s2;
+    b->m3 = s3;
+    b->m4 = s4;
+}
+
+/* Fold n contiguous values into m */
+static void moments_add(Moments *m, const double *x, size_t n) {
+    size_t i;
+    Moments b;
+
+    for (i = 0; i < n; i += MOMENTS_BLOCK) {
+        moments_block(x + i, n - i < MOMENTS_BLOCK ? n - i : MOMENTS_BLOCK, &b);
+        moments_merge(m, &b);
+    }
+}
+
+#define MOMENTS_TILE_ROWS 32     /* Rows x columns summarized per tile (128 KB) */
+#define MOMENTS_TILE_COLS 512
+
+/* Fold each column of a row-major n_rows x n_cols block into cols[c].
+ * Tiles are summarized about their per-column means like moments_block;
+ * every inner loop runs along a row, so it streams memory in order and
+ * vectorizes across columns. */
+static void moments_add_columns(Moments *cols, const double *x, size_t n_rows, size_t n_cols) {
+    double sum[MOMENTS_TILE_COLS], lo[MOMENTS_TILE_COLS], hi[MOMENTS_TILE_COLS];
+    double s2[MOMENTS_TILE_COLS], s3[MOMENTS_TILE_COLS], s4[MOMENTS_TILE_COLS];
+    size_t r0, c0, r, c;
+
+    for (r0 = 0; r0 < n_rows; r0 += MOMENTS_TILE_ROWS) {
+        size_t nr = n_rows - r0 < MOMENTS_TILE_ROWS ? n_rows - r0 : MOMENTS_TILE_ROWS;
+        for (c0 = 0; c0 < n_cols; c0 += MOMENTS_TILE_COLS) {
+            size_t w = n_cols - c0 < MOMENTS_TILE_COLS ? n_cols - c0 : MOMENTS_TILE_COLS;
+            const double *tile = x + r0 * n_cols + c0;
+
+            for (c = 0; c < w; c++) {
+                sum[c] = 0.0;
+                lo[c] = INFINITY;
+                hi[c] = -INFINITY;
+                s2[c] = s3[c] = s4[c] = 0.0;
             }
-            box_count++;
-        } else if (strncmp(line, "FabOnDisk:", 10) == 0) {
-            /* Parse FabOnDisk: Cell_D_XXXXX offset */
-            char *p = strchr(line, ':');
-            if (p) {
-                p++;
-                while (*p == ' ') p++;
-                char *end = strchr(p, ' ');
-                if (end) {
-                    *end = '\0';
-                    end++;
+            for (r = 0; r < nr; r++) {
+                const double *row = tile + r * n_cols;
+                for (c = 0; c < w; c++) {
+                    double v = row[c];
+                    sum[c] += v;
+                    lo[c] = v < lo[c] ? v : lo[c];
+                    hi[c] = v > hi[c] ? v : hi[c];
                 }
-                char *line_end = strchr(p, '\n');
-                if (line_end) *line_end = '\0';
-                strncpy(ld->boxes[ld->n_boxes].filename, p, 63);
-                ld->boxes[ld->n_boxes].filename[63] = '\0';
-                ld->boxes[ld->n_boxes].offset = 0;
-                if (end) {
-                    while (*end == ' ') end++;
-                    if (*end) {
-                        ld->boxes[ld->n_boxes].offset = strtoll(end, NULL, 10);
-                    }
+            }
+            for (c = 0; c < w; c++) sum[c] /= (double)nr;    /* Now the tile mean */
+            for (r = 0; r < nr; r++) {
+                const double *row = tile + r * n_cols;
+                for (c = 0; c < w; c++) {
+                    double d = row[c] - sum[c], dd = d * d;
+                    s2[c] += dd;
+                    s3[c] += dd * d;
+                    s4[c] += dd * dd;
                 }
-                ld->n_boxes++;
+            }
+            for (c = 0; c < w; c++) {
+                Moments b = { (double)nr, lo[c], hi[c], sum[c], s2[c], s3[c], s4[c] };
+                moments_merge(&cols[c0 + c], &b);
             }
         }
     }
+}
 
-    fclose(fp);
-
-    /* Store level bounds and grid dimensions */
-    for (i = 0; i < pf->ndim; i++) {
-        ld->level_lo[i] = level_lo[i];
-        ld->level_hi[i] = level_hi[i];
-        ld->grid_dims[i] = level_hi[i] - level_lo[i] + 1;
+typedef struct {
+    const double *x;
+    size_t n;
+    Moments *partial;           /* One per chunk */
+} MomentsJob;
+
+static void moments_chunk(void *ctx, int item) {
+    const MomentsJob *job = (const MomentsJob *)ctx;
+    size_t lo = (size_t)item * MOMENTS_CHUNK;
+    size_t hi = lo + MOMENTS_CHUNK < job->n ? lo + MOMENTS_CHUNK : job->n;
+
+    moments_init(&job->partial[item]);
+    moments_add(&job->partial[item], job->x + lo, hi - lo);
+}
+
+/* Moments of n contiguous values, reduced over the worker pool in chunks;
+ * partials are merged in chunk order, so the result does not depend on
+ * the thread count */
+static void moments_compute(const double *x, size_t n, Moments *m) {
+    size_t n_chunks = (n + MOMENTS_CHUNK - 1) / MOMENTS_CHUNK;
+    size_t c;
+
+    moments_init(m);
+    Moments *partial = n_chunks > 1 ? (Moments *)malloc(n_chunks * sizeof(Moments)) : NULL;
+    if (!partial) {
+        moments_add(m, x, n);
+        return;
     }
-    normalize_level_dims(pf, ld);
+    MomentsJob job = { x, n, partial };
+    pool_run(moments_chunk, &job, (int)n_chunks);
+    for (c = 0; c < n_chunks; c++) moments_merge(m, &partial[c]);
+    free(partial);
+}
 
-    printf("Level %d overlay: Found %d boxes, Grid: %d x %d x %d (lo: %d,%d,%d)\n",
-           level, ld->n_boxes,
-           ld->grid_dims[0], ld->grid_dims[1], ld->grid_dims[2],
-           ld->level_lo[0], ld->level_lo[1], ld->level_lo[2]);
-    return 0;
+/* Population statistics of a result */
+static inline double moments_mean(const Moments *m) {
+    return m->n > 0 ? m->mean : 0.0;
 }
 
-/* Read variable data for a specific level into LevelData */
-int read_variable_data_level(PlotfileData *pf, int var_idx, int level) {
-    char path[MAX_PATH];
-    FILE *fp;
-    int box_idx, i, j, k;
-    LevelData *ld = &pf->levels[level];
+static inline double moments_std(const Moments *m) {
+    return m->n > 0 ? sqrt(m->m2 / m->n) : 0.0;
+}
 
-    size_t total_size = (size_t)ld->grid_dims[0] * ld->grid_dims[1] * ld->grid_dims[2];
+static inline double moments_skewness(const Moments *m) {
+    if (m->n == 0.0 || m->m2 <= 0.0) return 0.0;
+    return sqrt(m->n) * m->m3 / pow(m->m2, 1.5);
+}
 
-    /* Allocate data array */
-    if (ld->data) free(ld->data);
-    ld->data = (double *)calloc(total_size, sizeof(double));
-    if (!ld->data) {
-        fprintf(stderr, "Error: Cannot allocate memory for level %d\n", level);
-        return -1;
-    }
+static inline double moments_kurtosis(const Moments *m) {
+    if (m->n == 0.0 || m->m2 <= 0.0) return 0.0;
+    return m->n * m->m4 / (m->m2 * m->m2);
+}
 
-    /* Read each box */
-    for (box_idx = 0; box_idx < ld->n_boxes; box_idx++) {
-        Box *box = &ld->boxes[box_idx];
-        int box_dims[3];
-        for (i = 0; i < 3; i++) {
-            box_dims[i] = box->hi[i] - box->lo[i] + 1;
-        }
-        size_t box_size = box_dims[0] * box_dims[1] * box_dims[2];
+/* ========== Plane Summary Index ========== */
 
-        snprintf(path, MAX_PATH, "%s/Level_%d/%s", pf->plotfile_dir, level, box->filename);
-        fp = fopen(path, "rb");
-        if (!fp) continue;
+/* Moments of every z, y and x plane of a loaded variable, built in one
+ * sweep when a volume is decoded and kept with it: pf->plane_index for the
+ * volume in pf->data, and a copy with the volume in the variable cache, so
+ * a cache hit gets its index back without rescanning. Profile, the auto
+ * colorbar range, Distribution, Series and the time-height plot look
+ * planes up here; the whole domain is the merge of its z planes. An index
+ * is O(nx + ny + nz). */
+typedef struct PlaneIndex {
+    int dims[3];
+    Moments *planes[3];         /* planes[a][i]: cells with index i along axis a */
+} PlaneIndex;
 
-        /* Seek to FAB header offset if provided */
-        if (box->offset > 0) {
-            fseeko(fp, (off_t)box->offset, SEEK_SET);
+typedef struct {
+    const double *data;
+    const int *dims;
+    int planes_per_item;
+    Moments *z_planes;
+    Moments *partial;           /* nx + ny accumulators per item */
+} PlaneIndexJob;
+
+/* Sweep planes [k0, k1): every row feeds its y plane and its z plane, and
+ * the plane, still in cache, feeds the x planes column-wise */
+static void plane_index_sweep(void *ctx, int item) {
+    const PlaneIndexJob *job = (const PlaneIndexJob *)ctx;
+    size_t nx = job->dims[0], ny = job->dims[1], nz = job->dims[2];
+    size_t k0 = (size_t)item * job->planes_per_item;
+    size_t k1 = k0 + job->planes_per_item < nz ? k0 + job->planes_per_item : nz;
+    Moments *xs = job->partial + (size_t)item * (nx + ny), *ys = xs + nx;
+    size_t i, j, k;
+
+    for (i = 0; i < nx + ny; i++) moments_init(&xs[i]);
+    for (k = k0; k < k1; k++) {
+        const double *plane = job->data + k * nx * ny;
+        Moments *z = &job->z_planes[k];
+        moments_init(z);
+        for (j = 0; j < ny; j++) {
+            Moments row;
+            moments_init(&row);
+            moments_add(&row, plane + j * nx, nx);
+            moments_merge(&ys[j], &row);
+            moments_merge(z, &row);
         }
+        moments_add_columns(xs, plane, ny, nx);
+    }
+}
 
-        /* Skip FAB header */
-        int c;
-        while ((c = fgetc(fp)) != EOF && c != '\n');
+static void plane_index_free(PlaneIndex *index) {
+    int a;
+    if (!index) return;
+    for (a = 0; a < 3; a++) free(index->planes[a]);
+    free(index);
+}
+
+static PlaneIndex *plane_index_alloc(const int dims[3]) {
+    PlaneIndex *index = (PlaneIndex *)calloc(1, sizeof(PlaneIndex));
+    int a;
+
+    if (!index) return NULL;
+    for (a = 0; a < 3; a++) {
+        index->dims[a] = dims[a];
+        index->planes[a] = (Moments *)malloc((size_t)dims[a] * sizeof(Moments));
+        if (!index->planes[a]) {
+            plane_index_free(index);
+            return NULL;
+        }
+    }
+    return index;
+}
+
+/* Build the index of a freshly decoded nx x ny x nz volume, or NULL */
+static PlaneIndex *plane_index_build(const double *data, const int dims[3]) {
+    int a, l, item;
+
+    if (!data || dims[0] <= 0 || dims[1] <= 0 || dims[2] <= 0) return NULL;
+    PlaneIndex *index = plane_index_alloc(dims);
+    if (!index) return NULL;
+
+    /* A few plane ranges per thread, partial x/y planes merged in order */
+    int n_items = 4 * pool_thread_count();
+    if (n_items > dims[2]) n_items = dims[2];
+    int per_item = (dims[2] + n_items - 1) / n_items;
+    n_items = (dims[2] + per_item - 1) / per_item;
+    size_t stride = (size_t)dims[0] + dims[1];
+    Moments *partial = (Moments *)malloc((size_t)n_items * stride * sizeof(Moments));
+    if (!partial) {
+        plane_index_free(index);
+        return NULL;
+    }
+    PlaneIndexJob job = { data, dims, per_item, index->planes[2], partial };
+    pool_run(plane_index_sweep, &job, n_items);
+
+    for (a = 0; a < 2; a++) {
+        size_t off = a == 0 ? 0 : (size_t)dims[0];
+        for (l = 0; l < dims[a]; l++) {
+            index->planes[a][l] = partial[off + l];
+            for (item = 1; item < n_items; item++) {
+                moments_merge(&index->planes[a][l], &partial[(size_t)item * stride + off + l]);
+            }
+        }
+    }
+    free(partial);
+    return index;
+}
 
-        /* Skip to variable data */
-        fseeko(fp, (off_t)(var_idx * box_size * sizeof(double)), SEEK_CUR);
+static PlaneIndex *plane_index_copy(const PlaneIndex *src) {
+    PlaneIndex *index = src ? plane_index_alloc(src->dims) : NULL;
+    int a;
 
-        /* Read box data */
-        double *box_data = (double *)malloc(box_size * sizeof(double));
-        fread(box_data, sizeof(double), box_size, fp);
+    if (!index) return NULL;
+    for (a = 0; a < 3; a++) {
+        memcpy(index->planes[a], src->planes[a], (size_t)src->dims[a] * sizeof(Moments));
+    }
+    return index;
+}
+
+/* Plane summaries along axis for pf's loaded volume, or NULL when it has
+ * no index */
+static const Moments *plane_index_lookup(const PlotfileData *pf, int axis) {
+    const PlaneIndex *index = pf->plane_index;
+    if (!pf->data || !index) return NULL;
+    if (index->dims[0] != pf->grid_dims[0] || index->dims[1] != pf->grid_dims[1] ||
+        index->dims[2] != pf->grid_dims[2]) return NULL;
+    return index->planes[axis];
+}
+
+/* ========== FAB Reader ========== */
+
+/* On-disk real format of one FAB, parsed from its RealDescriptor, e.g.
+ * FAB ((8, (64 11 52 0 1 12 0 1023)),(8, (8 7 6 5 4 3 2 1)))((lo) (hi) (t)) ncomp */
+typedef struct {
+    int nbytes;   /* 4 = float32, 8 = float64 */
+    int swap;     /* 1 if the byte order differs from the host */
+} FabRealFormat;
+
+static int host_is_little_endian(void) {
+    const unsigned short one = 1;
+    return *(const unsigned char *)&one == 1;
+}
+
+/* Parse the real descriptor at the start of a FAB header line. Unknown or
+ * missing descriptors fall back to native-endian double. */
+static void parse_fab_real_format(const char *hdr, size_t len, FabRealFormat *fmt) {
+    char line[MAX_LINE];
+    size_t n = len < sizeof(line) - 1 ? len : sizeof(line) - 1;
+    memcpy(line, hdr, n);
+    line[n] = '\0';
+
+    fmt->nbytes = (int)sizeof(double);
+    fmt->swap = 0;
+
+    /* Float format: "((nbytes, (...))" */
+    char *p = strstr(line, "((");
+    if (!p) return;
+    int nbytes = atoi(p + 2);
+    if (nbytes != 4 && nbytes != 8) {
+        fprintf(stderr, "Warning: Unsupported FAB real size %d, assuming double\n", nbytes);
+        return;
+    }
+    fmt->nbytes = nbytes;
+
+    /* Byte order: ",(nbytes, (o1 o2 ... on))" - o1 == 1 is big-endian,
+     * o1 == nbytes is little-endian */
+    p = strstr(p, "),(");
+    if (!p) return;
+    p = strchr(p + 3, '(');
+    if (!p) return;
+    int first = atoi(p + 1);
+    int file_little = (first == nbytes && nbytes > 1);
+    if (first != 1 && !file_little) return;
+    fmt->swap = (file_little != host_is_little_endian());
+}
+
+/* Byte-swap n 64-bit reals from src into dst */
+static void fab_bswap64(double *dst, const unsigned char *src, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i shuf = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                          7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i * 8));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_shuffle_epi8(v, shuf));
+    }
+#elif defined(__SSSE3__)
+    const __m128i shuf = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    for (; i + 2 <= n; i += 2) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i * 8));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_shuffle_epi8(v, shuf));
+    }
+#endif
+    for (; i < n; i++) {
+        unsigned long long u;
+        memcpy(&u, src + i * 8, 8);
+        u = __builtin_bswap64(u);
+        memcpy(&dst[i], &u, 8);
+    }
+}
+
+/* Widen n float32 reals (optionally byte-swapped) from src into dst */
+static void fab_widen_f32(double *dst, const unsigned char *src, size_t n, int swap) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i shuf = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i * 4));
+        if (swap) v = _mm256_shuffle_epi8(v, shuf);
+        __m256 f = _mm256_castsi256_ps(v);
+        _mm256_storeu_pd(dst + i, _mm256_cvtps_pd(_mm256_castps256_ps128(f)));
+        _mm256_storeu_pd(dst + i + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(f, 1)));
+    }
+#elif defined(__SSSE3__)
+    const __m128i shuf = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i * 4));
+        if (swap) v = _mm_shuffle_epi8(v, shuf);
+        __m128 f = _mm_castsi128_ps(v);
+        _mm_storeu_pd(dst + i, _mm_cvtps_pd(f));
+        _mm_storeu_pd(dst + i + 2, _mm_cvtps_pd(_mm_movehl_ps(f, f)));
+    }
+#endif
+    for (; i < n; i++) {
+        unsigned int u;
+        float f;
+        memcpy(&u, src + i * 4, 4);
+        if (swap) u = __builtin_bswap32(u);
+        memcpy(&f, &u, 4);
+        dst[i] = f;
+    }
+}
+
+/* Convert n reals in the given on-disk format to native doubles */
+static void fab_convert_row(double *dst, const unsigned char *src, size_t n,
+                            const FabRealFormat *fmt) {
+    if (fmt->nbytes == 4) {
+        fab_widen_f32(dst, src, n, fmt->swap);
+    } else if (fmt->swap) {
+        fab_bswap64(dst, src, n);
+    } else {
+        memcpy(dst, src, n * sizeof(double));
+    }
+}
+
+/* How FAB data is pulled in: PLTVIEW_IO=mmap (default), pread, or direct
+ * (pread with O_DIRECT for reads of at least FAB_DIRECT_MIN_BYTES) */
+#define FAB_IO_MMAP 0
+#define FAB_IO_PREAD 1
+#define FAB_IO_DIRECT 2
+#define FAB_DIRECT_MIN_BYTES (1 << 20)
+#define FAB_DIRECT_ALIGN 4096
+
+static int fab_io = FAB_IO_MMAP;
+static pthread_once_t fab_io_once = PTHREAD_ONCE_INIT;
+
+static void fab_io_init(void) {
+    const char *env = getenv("PLTVIEW_IO");
+    if (!env || strcmp(env, "mmap") == 0) return;
+    if (strcmp(env, "pread") == 0) {
+        fab_io = FAB_IO_PREAD;
+    } else if (strcmp(env, "direct") == 0) {
+        fab_io = FAB_IO_DIRECT;
+    } else {
+        fprintf(stderr, "Warning: Unknown PLTVIEW_IO '%s', using mmap\n", env);
+    }
+}
+
+static int fab_io_backend(void) {
+    pthread_once(&fab_io_once, fab_io_init);
+    return fab_io;
+}
+
+/* A Cell_D_XXXXX file opened for the duration of one variable read: mapped
+ * read-only with the mmap backend, kept open for pread otherwise */
+typedef struct {
+    char name[64];
+    const unsigned char *base;  /* Start of the mapping, NULL if not mapped */
+    size_t size;                /* File size in bytes */
+    int fd;                     /* Descriptor for pread, -1 if mapped or unopened */
+    int fd_direct;              /* O_DIRECT descriptor for large reads, or -1 */
+} FabMapping;
+
+/* Set of mapped Cell_D files for one level directory */
+typedef struct {
+    char level_dir[MAX_PATH];
+    FabMapping *maps;
+    int n_maps;
+    int cap_maps;
+    int last;                   /* Most recently used mapping */
+} FabMapSet;
+
+/* Find the mapping for a Cell_D file, opening it on first use */
+static FabMapping *fab_map_get(FabMapSet *set, const char *name) {
+    int m;
+
+    /* Boxes sharing a file are usually listed consecutively */
+    if (set->n_maps > 0 && strcmp(set->maps[set->last].name, name) == 0) {
+        return &set->maps[set->last];
+    }
+    for (m = 0; m < set->n_maps; m++) {
+        if (strcmp(set->maps[m].name, name) == 0) {
+            set->last = m;
+            return &set->maps[m];
+        }
+    }
+
+    if (set->n_maps == set->cap_maps) {
+        int new_cap = set->cap_maps > 0 ? set->cap_maps * 2 : 16;
+        FabMapping *tmp = (FabMapping *)realloc(set->maps, new_cap * sizeof(FabMapping));
+        if (!tmp) return NULL;
+        set->maps = tmp;
+        set->cap_maps = new_cap;
+    }
+
+    FabMapping *fm = &set->maps[set->n_maps];
+    memset(fm, 0, sizeof(*fm));
+    strncpy(fm->name, name, 63);
+    fm->fd = fm->fd_direct = -1;
+
+    char path[MAX_PATH];
+    int n = snprintf(path, MAX_PATH, "%s/%s", set->level_dir, name);
+    int io = fab_io_backend();
+    int fd = (n >= 0 && n < MAX_PATH) ? open(path, O_RDONLY) : -1;
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            fm->size = (size_t)st.st_size;
+            if (io == FAB_IO_MMAP) {
+                void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) fm->base = (const unsigned char *)p;
+            } else {
+                fm->fd = fd;
+#ifdef O_DIRECT
+                /* Not every filesystem supports O_DIRECT; plain pread then */
+                if (io == FAB_IO_DIRECT) fm->fd_direct = open(path, O_RDONLY | O_DIRECT);
+#endif
+            }
+        }
+        /* The mapping stays valid after the descriptor is closed */
+        if (fm->fd < 0) close(fd);
+    }
+
+    set->last = set->n_maps;
+    set->n_maps++;
+    return fm;
+}
+
+/* Unmap all files in the set */
+static void fab_map_release(FabMapSet *set) {
+    int m;
+    for (m = 0; m < set->n_maps; m++) {
+        if (set->maps[m].base) {
+            munmap((void *)set->maps[m].base, set->maps[m].size);
+        }
+        if (set->maps[m].fd >= 0) close(set->maps[m].fd);
+        if (set->maps[m].fd_direct >= 0) close(set->maps[m].fd_direct);
+    }
+    free(set->maps);
+    set->maps = NULL;
+    set->n_maps = set->cap_maps = set->last = 0;
+}
+
+/* Copy the part of one box (Fortran order, X fastest) that falls inside the
+ * window [lo, lo+dims) into the C-order destination array. X runs are contiguous
+ * in both layouts, so each (j,k) row is converted in one call; a window that is
+ * one cell thick in X degenerates to a strided pencil. src holds the
+ * component from element src_first on. */
+static void fab_scatter_box(const unsigned char *src, size_t src_first, const FabRealFormat *fmt,
+                            const Box *box, const int box_dims[3],
+                            const int clip_lo[3], const int clip_hi[3],
+                            double *dest, const int dims[3], const int lo[3]) {
+    int j, k;
+    size_t n = (size_t)(clip_hi[0] - clip_lo[0] + 1);
+    int gx = clip_lo[0] - lo[0];
+
+    for (k = clip_lo[2]; k <= clip_hi[2]; k++) {
+        int gz = k - lo[2];
+        for (j = clip_lo[1]; j <= clip_hi[1]; j++) {
+            int gy = j - lo[1];
+            size_t gidx = ((size_t)gz * dims[1] + gy) * dims[0] + gx;
+            size_t sidx = ((size_t)(k - box->lo[2]) * box_dims[1] + (j - box->lo[1])) * box_dims[0]
+                        + (clip_lo[0] - box->lo[0]) - src_first;
+            fab_convert_row(&dest[gidx], src + sidx * fmt->nbytes, n, fmt);
+        }
+    }
+}
+
+/* Fallback for files that cannot be mapped: read the raw component through
+ * stdio into box_bytes (sized for the largest real) */
+static int fab_read_box_stdio(const char *path, const Box *box, int var_idx,
+                              size_t box_size, unsigned char *box_bytes,
+                              FabRealFormat *fmt) {
+    char hdr[MAX_LINE];
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return -1;
+
+    /* Seek to FAB header offset if provided */
+    if (box->offset > 0) {
+        fseeko(fp, (off_t)box->offset, SEEK_SET);
+    }
+
+    /* Parse FAB header, then skip the rest of the line */
+    if (!fgets(hdr, sizeof(hdr), fp)) {
         fclose(fp);
+        return -1;
+    }
+    parse_fab_real_format(hdr, strlen(hdr), fmt);
+    if (!strchr(hdr, '\n')) {
+        int c;
+        while ((c = fgetc(fp)) != EOF && c != '\n');
+    }
 
-        /* Insert into level array using relative indices */
-        size_t idx = 0;
-        for (k = 0; k < box_dims[2]; k++) {
-            for (j = 0; j < box_dims[1]; j++) {
-                for (i = 0; i < box_dims[0]; i++) {
-                    int gx = box->lo[0] + i - ld->level_lo[0];
-                    int gy = box->lo[1] + j - ld->level_lo[1];
-                    int gz = box->lo[2] + k - ld->level_lo[2];
-                    size_t gidx = gz * ld->grid_dims[1] * ld->grid_dims[0] +
-                                  gy * ld->grid_dims[0] + gx;
-                    ld->data[gidx] = box_data[idx++];
-                }
+    /* Skip to variable data */
+    fseeko(fp, (off_t)((size_t)var_idx * box_size * fmt->nbytes), SEEK_CUR);
+
+    size_t nread = fread(box_bytes, fmt->nbytes, box_size, fp);
+    fclose(fp);
+    return nread == box_size ? 0 : -1;
+}
+
+/* One box of one component, read by a pool worker. Boxes write disjoint
+ * regions of dest, so jobs need no locking. A job is first located (its FAB
+ * header parsed, which fixes the file range it needs) and then read. When
+ * several components of a box are queued, the later ones follow the first
+ * job's header instead of parsing it again. */
+typedef struct FabBoxJob {
+    const FabMapSet *set;
+    int map_idx;                /* -1: file could not be opened, use stdio */
+    const Box *box;
+    int var_idx;
+    double *dest;
+    int dims[3];
+    int lo[3];
+    int clip_lo[3];
+    int clip_hi[3];
+    const struct FabBoxJob *lead;  /* Job whose header this one shares, or NULL */
+    int located;                /* 1 = range known, -1 = unreadable, 0 = not yet */
+    FabRealFormat fmt;
+    size_t data_start;          /* File offset of the box's first component */
+    size_t span_first;          /* First component element the clip window touches */
+    size_t span_count;          /* Elements up to and including the last one touched */
+    off_t span_offset;          /* File offset of element span_first */
+    int ok;
+} FabBoxJob;
+
+/* Work out the byte range of the component rows that a job's clip window
+ * touches, once fmt and data_start are known */
+static void fab_box_job_set_span(FabBoxJob *job) {
+    const Box *box = job->box;
+    const FabMapping *fm = &job->set->maps[job->map_idx];
+    int box_dims[3], i;
+
+    for (i = 0; i < 3; i++) box_dims[i] = box->hi[i] - box->lo[i] + 1;
+    size_t box_size = (size_t)box_dims[0] * box_dims[1] * box_dims[2];
+    size_t comp_bytes = box_size * job->fmt.nbytes;
+    size_t comp_start = job->data_start + (size_t)job->var_idx * comp_bytes;
+    if (comp_start + comp_bytes > fm->size) {
+        fprintf(stderr, "Warning: Truncated FAB in %s/%s\n", job->set->level_dir, box->filename);
+        job->located = -1;
+        return;
+    }
+
+    size_t first = ((size_t)(job->clip_lo[2] - box->lo[2]) * box_dims[1]
+                    + (job->clip_lo[1] - box->lo[1])) * box_dims[0] + (job->clip_lo[0] - box->lo[0]);
+    size_t last = ((size_t)(job->clip_hi[2] - box->lo[2]) * box_dims[1]
+                   + (job->clip_hi[1] - box->lo[1])) * box_dims[0] + (job->clip_hi[0] - box->lo[0]);
+    job->span_first = first;
+    job->span_count = last - first + 1;
+    job->span_offset = (off_t)(comp_start + first * job->fmt.nbytes);
+    job->located = 1;
+}
+
+/* Locate a job: reuse its lead's header if that is already parsed, else
+ * parse the FAB header of its box */
+static void fab_box_job_locate(void *ctx, int item) {
+    FabBoxJob *job = &((FabBoxJob *)ctx)[item];
+    const Box *box = job->box;
+    size_t offset = box->offset > 0 ? (size_t)box->offset : 0;
+    size_t hdr_len;
+
+    job->located = -1;
+    if (job->map_idx < 0) return;
+    if (job->lead && job->lead->located > 0) {
+        job->fmt = job->lead->fmt;
+        job->data_start = job->lead->data_start;
+        fab_box_job_set_span(job);
+        return;
+    }
+    const FabMapping *fm = &job->set->maps[job->map_idx];
+    if (offset >= fm->size) return;
+
+    /* The header runs up to and including the newline */
+    if (fm->base) {
+        const unsigned char *hdr = fm->base + offset;
+        const unsigned char *nl = (const unsigned char *)memchr(hdr, '\n', fm->size - offset);
+        if (!nl) return;
+        hdr_len = (size_t)(nl - hdr);
+        parse_fab_real_format((const char *)hdr, hdr_len, &job->fmt);
+    } else {
+        char hdr[MAX_LINE];
+        ssize_t got = pread(fm->fd, hdr, sizeof(hdr), (off_t)offset);
+        const char *nl = got > 0 ? (const char *)memchr(hdr, '\n', (size_t)got) : NULL;
+        if (!nl) return;
+        hdr_len = (size_t)(nl - hdr);
+        parse_fab_real_format(hdr, hdr_len, &job->fmt);
+    }
+    job->data_start = offset + hdr_len + 1;
+    fab_box_job_set_span(job);
+}
+
+/* Pool pass over lead jobs only; followers are filled in afterwards */
+static void fab_box_job_locate_lead(void *ctx, int item) {
+    if (!((FabBoxJob *)ctx)[item].lead) fab_box_job_locate(ctx, item);
+}
+
+/* Read planner. Located jobs are grouped by Cell_D file and sorted by file
+ * offset; spans at most FAB_COALESCE_GAP bytes apart are merged into runs of
+ * up to FAB_COALESCE_MAX bytes. Each run is fetched with one pread (or
+ * advised as one range of the mapping) and then scattered box by box, so
+ * thousands of small random reads become a few large sequential ones. */
+#define FAB_COALESCE_GAP (256 << 10)
+#define FAB_COALESCE_MAX (16 << 20)
+
+/* Runs are fetched in windows of at most FAB_WINDOW_RUNS buffered runs and
+ * FAB_WINDOW_BYTES, so a level is never held twice in memory */
+#define FAB_WINDOW_RUNS 64
+#define FAB_WINDOW_BYTES (256 << 20)
+
+typedef struct {
+    const FabMapping *fm;       /* NULL: job was not located, run it on its own */
+    off_t offset;
+    size_t len;
+    int first;                  /* First entry of this run in plan order */
+    int n;
+    void *buf;                  /* Fetched range while its window is live, or NULL */
+    const unsigned char *data;  /* First byte of the run inside buf */
+} FabReadRun;
+
+typedef struct {
+    FabBoxJob *jobs;
+    int *order;                 /* Job indices, grouped by run */
+    int *run_of;                /* Run of each entry in plan order */
+    FabReadRun *runs;
+    int n_runs;
+} FabReadPlan;
+
+typedef struct {
+    const FabMapping *fm;
+    off_t offset;
+    int job;
+} FabSpanKey;
+
+static int compare_span_keys(const void *a, const void *b) {
+    const FabSpanKey *ka = (const FabSpanKey *)a, *kb = (const FabSpanKey *)b;
+    if (ka->fm != kb->fm) return (uintptr_t)ka->fm < (uintptr_t)kb->fm ? -1 : 1;
+    if (ka->offset != kb->offset) return ka->offset < kb->offset ? -1 : 1;
+    return ka->job - kb->job;
+}
+
+static size_t fab_job_span_bytes(const FabBoxJob *job) {
+    return job->span_count * job->fmt.nbytes;
+}
+
+static void fab_plan_free(FabReadPlan *plan) {
+    free(plan->order);
+    free(plan->run_of);
+    free(plan->runs);
+    plan->order = NULL;
+    plan->run_of = NULL;
+    plan->runs = NULL;
+    plan->n_runs = 0;
+}
+
+static int fab_plan_reads(FabBoxJob *jobs, int n_jobs, FabReadPlan *plan) {
+    int k;
+
+    memset(plan, 0, sizeof(*plan));
+    plan->jobs = jobs;
+    if (n_jobs <= 0) return 0;
+
+    FabSpanKey *keys = (FabSpanKey *)malloc(n_jobs * sizeof(FabSpanKey));
+    plan->order = (int *)malloc(n_jobs * sizeof(int));
+    plan->run_of = (int *)malloc(n_jobs * sizeof(int));
+    plan->runs = (FabReadRun *)malloc(n_jobs * sizeof(FabReadRun));
+    if (!keys || !plan->order || !plan->run_of || !plan->runs) {
+        free(keys);
+        fab_plan_free(plan);
+        return -1;
+    }
+
+    for (k = 0; k < n_jobs; k++) {
+        const FabBoxJob *job = &jobs[k];
+        keys[k].fm = job->located > 0 ? &job->set->maps[job->map_idx] : NULL;
+        keys[k].offset = job->located > 0 ? job->span_offset : 0;
+        keys[k].job = k;
+    }
+    qsort(keys, n_jobs, sizeof(FabSpanKey), compare_span_keys);
+
+    for (k = 0; k < n_jobs; k++) {
+        FabReadRun *run = plan->n_runs > 0 ? &plan->runs[plan->n_runs - 1] : NULL;
+        off_t end = keys[k].offset + (off_t)fab_job_span_bytes(&jobs[keys[k].job]);
+
+        plan->order[k] = keys[k].job;
+        if (run && keys[k].fm && run->fm == keys[k].fm &&
+            keys[k].offset <= run->offset + (off_t)run->len + FAB_COALESCE_GAP &&
+            end - run->offset <= FAB_COALESCE_MAX) {
+            if (end > run->offset + (off_t)run->len) run->len = (size_t)(end - run->offset);
+            run->n++;
+            plan->run_of[k] = plan->n_runs - 1;
+            continue;
+        }
+        plan->run_of[k] = plan->n_runs;
+        run = &plan->runs[plan->n_runs++];
+        run->fm = keys[k].fm;
+        run->offset = keys[k].offset;
+        run->len = keys[k].fm ? (size_t)(end - keys[k].offset) : 0;
+        run->first = k;
+        run->n = 1;
+        run->buf = NULL;
+        run->data = NULL;
+    }
+    free(keys);
+    return 0;
+}
+
+static int fab_range_uses_direct(const FabMapping *fm, size_t len) {
+    return fm->fd_direct >= 0 && len >= FAB_DIRECT_MIN_BYTES;
+}
+
+/* Announce every run to the kernel before any worker blocks on one, so the
+ * reads of all boxes are in flight together instead of one per worker at a
+ * time. O_DIRECT reads bypass the page cache and are left to the workers. */
+static void fab_advise_plan(const FabReadPlan *plan) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    int r;
+
+    for (r = 0; r < plan->n_runs; r++) {
+        const FabReadRun *run = &plan->runs[r];
+        if (!run->fm) continue;
+        if (run->fm->base) {
+            size_t start = (size_t)run->offset & ~(page - 1);
+            madvise((void *)(run->fm->base + start), (size_t)run->offset + run->len - start,
+                    MADV_WILLNEED);
+        } else if (!fab_range_uses_direct(run->fm, run->len)) {
+#if defined(POSIX_FADV_WILLNEED)
+            posix_fadvise(run->fm->fd, run->offset, (off_t)run->len, POSIX_FADV_WILLNEED);
+#elif defined(F_RDADVISE)
+            struct radvisory ra = { run->offset, (int)run->len };  /* macOS; runs are <= 16 MB */
+            fcntl(run->fm->fd, F_RDADVISE, &ra);
+#endif
+        }
+    }
+}
+
+static size_t fab_pread_full(int fd, void *buf, size_t len, off_t offset) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t got = pread(fd, (char *)buf + done, len - done, offset + (off_t)done);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        done += (size_t)got;
+    }
+    return done;
+}
+
+/* Buffer and file range for reading [offset, offset+len) of a mapping. O_DIRECT
+ * wants an aligned buffer, offset and length, so the range is widened to
+ * FAB_DIRECT_ALIGN and the wanted bytes start head bytes into the buffer. */
+typedef struct {
+    void *buf;
+    int fd;
+    off_t start;
+    size_t total;
+    size_t head;
+} FabRangeRead;
+
+static int fab_range_prepare(const FabMapping *fm, off_t offset, size_t len, int direct,
+                             FabRangeRead *rd) {
+    if (direct) {
+        rd->fd = fm->fd_direct;
+        rd->start = offset & ~(off_t)(FAB_DIRECT_ALIGN - 1);
+        rd->head = (size_t)(offset - rd->start);
+        rd->total = (rd->head + len + FAB_DIRECT_ALIGN - 1) & ~(size_t)(FAB_DIRECT_ALIGN - 1);
+        if (posix_memalign(&rd->buf, FAB_DIRECT_ALIGN, rd->total) != 0) rd->buf = NULL;
+    } else {
+        rd->fd = fm->fd;
+        rd->start = offset;
+        rd->head = 0;
+        rd->total = len;
+        rd->buf = malloc(len);
+    }
+    return rd->buf ? 0 : -1;
+}
+
+/* Read len bytes at offset with pread. Returns the buffer to free and sets
+ * *data to the first byte of the range, or returns NULL on failure. */
+static void *fab_pread_range(const FabMapping *fm, off_t offset, size_t len,
+                             const unsigned char **data) {
+    FabRangeRead rd;
+
+    if (fab_range_uses_direct(fm, len) && fab_range_prepare(fm, offset, len, 1, &rd) == 0) {
+        if (fab_pread_full(rd.fd, rd.buf, rd.total, rd.start) >= rd.head + len) {
+            *data = (const unsigned char *)rd.buf + rd.head;
+            return rd.buf;
+        }
+        free(rd.buf);  /* Retry through the page cache */
+    }
+
+    if (fab_range_prepare(fm, offset, len, 0, &rd) < 0) return NULL;
+    if (fab_pread_full(rd.fd, rd.buf, len, offset) != len) {
+        free(rd.buf);
+        return NULL;
+    }
+    *data = (const unsigned char *)rd.buf;
+    return rd.buf;
+}
+
+static void fab_scatter_job(FabBoxJob *job, const unsigned char *data) {
+    const Box *box = job->box;
+    int box_dims[3], i;
+
+    for (i = 0; i < 3; i++) box_dims[i] = box->hi[i] - box->lo[i] + 1;
+    fab_scatter_box(data, job->span_first, &job->fmt, box, box_dims,
+                    job->clip_lo, job->clip_hi, job->dest, job->dims, job->lo);
+    job->ok = 1;
+}
+
+static void fab_box_job_run(void *ctx, int item) {
+    FabBoxJob *job = &((FabBoxJob *)ctx)[item];
+    const Box *box = job->box;
+
+    if (job->map_idx >= 0) {
+        if (!job->located) fab_box_job_locate(ctx, item);
+        if (job->located < 0) return;
+
+        const FabMapping *fm = &job->set->maps[job->map_idx];
+        if (fm->base) {
+            fab_scatter_job(job, fm->base + job->span_offset);
+        } else {
+            const unsigned char *data;
+            void *buf = fab_pread_range(fm, job->span_offset, fab_job_span_bytes(job), &data);
+            if (!buf) {
+                fprintf(stderr, "Warning: Short read in %s/%s\n", job->set->level_dir, box->filename);
+                return;
+            }
+            fab_scatter_job(job, data);
+            free(buf);
+        }
+    } else {
+        char path[MAX_PATH];
+        FabRealFormat fmt;
+        int box_dims[3], i;
+        for (i = 0; i < 3; i++) box_dims[i] = box->hi[i] - box->lo[i] + 1;
+        size_t box_size = (size_t)box_dims[0] * box_dims[1] * box_dims[2];
+        int n = snprintf(path, MAX_PATH, "%s/%s", job->set->level_dir, box->filename);
+        if (n < 0 || n >= MAX_PATH) return;
+        unsigned char *box_bytes = (unsigned char *)malloc(box_size * sizeof(double));
+        if (!box_bytes) return;
+        if (fab_read_box_stdio(path, box, job->var_idx, box_size, box_bytes, &fmt) == 0) {
+            fab_scatter_box(box_bytes, 0, &fmt, box, box_dims, job->clip_lo, job->clip_hi,
+                            job->dest, job->dims, job->lo);
+            job->ok = 1;
+        }
+        free(box_bytes);
+    }
+}
+
+/* Runs read through a descriptor need a buffer; mapped runs and stdio jobs
+ * are scattered straight from the file */
+static int fab_run_is_buffered(const FabReadRun *run) {
+    return run->fm && !run->fm->base;
+}
+
+/* Fetch a buffered run into run->buf, unless that already happened */
+static void fab_fetch_run(FabReadPlan *plan, int r) {
+    FabReadRun *run = &plan->runs[r];
+
+    if (!fab_run_is_buffered(run) || run->buf) return;
+    run->buf = fab_pread_range(run->fm, run->offset, run->len, &run->data);
+    if (!run->buf) {
+        fprintf(stderr, "Warning: Short read in %s/%s\n",
+                plan->jobs[plan->order[run->first]].set->level_dir, run->fm->name);
+    }
+}
+
+/* Scatter the job at position pos of the plan order from its run */
+static void fab_scatter_entry(FabReadPlan *plan, int pos) {
+    const FabReadRun *run = &plan->runs[plan->run_of[pos]];
+    FabBoxJob *job = &plan->jobs[plan->order[pos]];
+
+    if (run->data) {
+        fab_scatter_job(job, run->data + (job->span_offset - run->offset));
+    } else if (!fab_run_is_buffered(run)) {
+        /* Mapped runs are already advised; stdio jobs go one by one */
+        fab_box_job_run(plan->jobs, plan->order[pos]);
+    }
+}
+
+static void fab_run_release(FabReadRun *run) {
+    free(run->buf);
+    run->buf = NULL;
+    run->data = NULL;
+}
+
+/* Fetch one run of the plan and scatter all of its boxes */
+static void fab_read_run(void *ctx, int item) {
+    FabReadPlan *plan = (FabReadPlan *)ctx;
+    FabReadRun *run = &plan->runs[item];
+    int i;
+
+    fab_fetch_run(plan, item);
+    for (i = 0; i < run->n; i++) fab_scatter_entry(plan, run->first + i);
+    fab_run_release(run);
+}
+
+/* Pool items over a window of runs or of plan entries, counted from base */
+typedef struct {
+    FabReadPlan *plan;
+    int base;
+} FabWindow;
+
+static void fab_fetch_window(void *ctx, int item) {
+    FabWindow *win = (FabWindow *)ctx;
+    fab_fetch_run(win->plan, win->base + item);
+}
+
+static void fab_scatter_window(void *ctx, int item) {
+    FabWindow *win = (FabWindow *)ctx;
+    fab_scatter_entry(win->plan, win->base + item);
+}
+
+/* io_uring backend for the pread and direct modes, driven through the raw
+ * syscalls so no liburing is needed. A whole window of runs is queued on
+ * one ring, so the device sees up to FAB_WINDOW_RUNS reads at once rather
+ * than one per worker. Kernels or sandboxes without io_uring, and reads the
+ * ring leaves short, fall back to fab_pread_range on the pool. A ring that
+ * fails mid-read is dropped for the rest of that read only. */
+#if defined(FAB_HAVE_URING)
+typedef struct {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_size, cq_size, sqes_size;
+} FabRing;
+
+static int fab_uring_unavailable = 0;   /* Set once setup is refused for good */
+static int fab_uring_leak_reported = 0;
+
+static void fab_ring_close(FabRing *ring) {
+    if (ring->sqes) munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ptr) munmap(ring->cq_ptr, ring->cq_size);
+    if (ring->sq_ptr) munmap(ring->sq_ptr, ring->sq_size);
+    if (ring->fd >= 0) close(ring->fd);
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+static int fab_ring_open(FabRing *ring, unsigned entries) {
+    struct io_uring_params p;
+
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+    if (__atomic_load_n(&fab_uring_unavailable, __ATOMIC_RELAXED)) return -1;
+
+    memset(&p, 0, sizeof(p));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (ring->fd < 0) {
+        /* No io_uring in this kernel, or forbidden by a seccomp filter or
+         * sysctl: stop asking. Anything else (ENOMEM, EMFILE) may pass. */
+        if (errno == ENOSYS || errno == EPERM) {
+            __atomic_store_n(&fab_uring_unavailable, 1, __ATOMIC_RELAXED);
+        }
+        return -1;
+    }
+
+    ring->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    void *sq = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring->fd, IORING_OFF_SQ_RING);
+    void *cq = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring->fd, IORING_OFF_CQ_RING);
+    void *sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    ring->sq_ptr = sq != MAP_FAILED ? sq : NULL;
+    ring->cq_ptr = cq != MAP_FAILED ? cq : NULL;
+    ring->sqes = sqes != MAP_FAILED ? (struct io_uring_sqe *)sqes : NULL;
+    if (!ring->sq_ptr || !ring->cq_ptr || !ring->sqes) {
+        fab_ring_close(ring);
+        return -1;
+    }
+
+    ring->sq_head = (unsigned *)((char *)sq + p.sq_off.head);
+    ring->sq_tail = (unsigned *)((char *)sq + p.sq_off.tail);
+    ring->sq_mask = (unsigned *)((char *)sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)((char *)sq + p.sq_off.array);
+    ring->cq_head = (unsigned *)((char *)cq + p.cq_off.head);
+    ring->cq_tail = (unsigned *)((char *)cq + p.cq_off.tail);
+    ring->cq_mask = (unsigned *)((char *)cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)((char *)cq + p.cq_off.cqes);
+    return 0;
+}
+
+static int fab_ring_enter(FabRing *ring, unsigned to_submit, unsigned min_complete) {
+    int ret;
+    do {
+        ret = (int)syscall(__NR_io_uring_enter, ring->fd, to_submit, min_complete,
+                           min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+    return ret;
+}
+
+/* Read the buffered runs [r0, r1) of a plan through the ring. Runs whose
+ * read fails or comes back short are left without a buffer. Returns -1 if
+ * io_uring_enter failed; the caller then closes the ring. */
+static int fab_uring_fetch(FabRing *ring, FabReadPlan *plan, int r0, int r1) {
+    FabRangeRead rd[FAB_WINDOW_RUNS];
+    struct iovec iov[FAB_WINDOW_RUNS];
+    int slot_run[FAB_WINDOW_RUNS];
+    char slot_done[FAB_WINDOW_RUNS];
+    unsigned n_slots = 0, queued = 0, done = 0;
+    int r, wait_err = 0;
+
+    for (r = r0; r < r1; r++) {
+        FabReadRun *run = &plan->runs[r];
+        if (!fab_run_is_buffered(run) || run->buf) continue;
+        if (n_slots == FAB_WINDOW_RUNS) break;
+        if (fab_range_prepare(run->fm, run->offset, run->len,
+                              fab_range_uses_direct(run->fm, run->len), &rd[n_slots]) < 0) {
+            continue;
+        }
+
+        unsigned tail = *ring->sq_tail;
+        unsigned idx = tail & *ring->sq_mask;
+        struct io_uring_sqe *sqe = &ring->sqes[idx];
+        memset(sqe, 0, sizeof(*sqe));
+        iov[n_slots].iov_base = rd[n_slots].buf;
+        iov[n_slots].iov_len = rd[n_slots].total;
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = rd[n_slots].fd;
+        sqe->off = (unsigned long long)rd[n_slots].start;
+        sqe->addr = (unsigned long long)(uintptr_t)&iov[n_slots];
+        sqe->len = 1;
+        sqe->user_data = n_slots;
+        ring->sq_array[idx] = idx;
+        __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+        slot_done[n_slots] = 0;
+        slot_run[n_slots++] = r;
+    }
+
+    /* Submit everything, then reap until every submitted read has completed */
+    while (queued < n_slots) {
+        int ret = fab_ring_enter(ring, n_slots - queued, 0);
+        if (ret <= 0) break;
+        queued += (unsigned)ret;
+    }
+    while (done < queued) {
+        unsigned head = *ring->cq_head;
+        if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+            if (fab_ring_enter(ring, 0, 1) < 0) {
+                wait_err = errno;
+                break;
+            }
+            continue;
+        }
+        const struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        unsigned slot = (unsigned)cqe->user_data;
+        FabReadRun *run = &plan->runs[slot_run[slot]];
+        if (cqe->res >= 0 && (size_t)cqe->res >= rd[slot].head + run->len) {
+            run->buf = rd[slot].buf;
+            run->data = (const unsigned char *)rd[slot].buf + rd[slot].head;
+            rd[slot].buf = NULL;
+        }
+        __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+        slot_done[slot] = 1;
+        done++;
+    }
+
+    /* Buffers of reads the kernel may still complete are leaked rather than
+     * freed under it; unsubmitted ones die with the ring */
+    for (r = 0; r < (int)n_slots; r++) {
+        if (slot_done[r] || (unsigned)r >= queued) free(rd[r].buf);
+    }
+    if (done < queued && !__atomic_exchange_n(&fab_uring_leak_reported, 1, __ATOMIC_RELAXED)) {
+        fprintf(stderr, "Warning: io_uring wait failed (%s); leaking the buffers of %u "
+                "unfinished reads\n", strerror(wait_err), queued - done);
+    }
+    return (queued < n_slots || done < queued) ? -1 : 0;
+}
+#endif
+
+/* Run a batch of queued jobs: locate every box, plan and announce the
+ * coalesced reads, then work through the runs window by window - fetch the
+ * window's runs on the pool, then scatter its boxes on the pool - so a
+ * level read as a few large runs still spreads its boxes over every worker */
+static void fab_run_jobs(FabBoxJob *jobs, int n_jobs) {
+    FabReadPlan plan;
+    FabWindow win;
+    int i, r0, r1;
+
+    pool_run(fab_box_job_locate_lead, jobs, n_jobs);
+    for (i = 0; i < n_jobs; i++) {
+        if (jobs[i].lead) fab_box_job_locate(jobs, i);
+    }
+    if (fab_plan_reads(jobs, n_jobs, &plan) < 0) {
+        pool_run(fab_box_job_run, jobs, n_jobs);
+        return;
+    }
+    fab_advise_plan(&plan);
+#if defined(FAB_HAVE_URING)
+    FabRing ring;
+    int use_ring = fab_io_backend() != FAB_IO_MMAP && fab_ring_open(&ring, FAB_WINDOW_RUNS) == 0;
+#endif
+
+    win.plan = &plan;
+    for (r0 = 0; r0 < plan.n_runs; r0 = r1) {
+        size_t bytes = 0;
+        int n_buffered = 0;
+        for (r1 = r0; r1 < plan.n_runs; r1++) {
+            const FabReadRun *run = &plan.runs[r1];
+            if (!fab_run_is_buffered(run)) continue;
+            if (n_buffered > 0 &&
+                (n_buffered == FAB_WINDOW_RUNS || bytes + run->len > FAB_WINDOW_BYTES)) break;
+            n_buffered++;
+            bytes += run->len;
+        }
+
+        if (n_buffered > 0) {
+#if defined(FAB_HAVE_URING)
+            /* A failed ring is closed; the next read opens a new one */
+            if (use_ring && fab_uring_fetch(&ring, &plan, r0, r1) < 0) {
+                fab_ring_close(&ring);
+                use_ring = 0;
             }
+#endif
+            /* Whatever the ring did not deliver is read with pread */
+            win.base = r0;
+            pool_run(fab_fetch_window, &win, r1 - r0);
+        }
+        win.base = plan.runs[r0].first;
+        pool_run(fab_scatter_window, &win, plan.runs[r1 - 1].first + plan.runs[r1 - 1].n - win.base);
+        for (i = r0; i < r1; i++) fab_run_release(&plan.runs[i]);
+    }
+#if defined(FAB_HAVE_URING)
+    if (use_ring) fab_ring_close(&ring);
+#endif
+    fab_plan_free(&plan);
+}
+
+/* Queue jobs for n_comps components (var_idxs[c] into dests[c]) of every
+ * box in a level, or only of the boxes listed in box_list if given, clipped
+ * to the destination window [lo, lo+dims). The components of a box are
+ * queued together, so the planner reads them in one sweep. Box components
+ * whose Cell_H range (ranges, may be NULL) is exactly zero are skipped, as
+ * the destinations start zero-filled. Files are mapped here, on the calling
+ * thread, so workers only read the mapping table. jobs must have room for
+ * n_boxes * n_comps entries. Returns the number of jobs added. */
+static int fab_queue_components(FabMapSet *set, const Box *boxes, const int *box_list,
+                                int n_boxes, const BoxRanges *ranges,
+                                const int *var_idxs, int n_comps,
+                                double *const *dests, const int dims[3], const int lo[3],
+                                FabBoxJob *jobs) {
+    int box_idx, c, i;
+    int n_jobs = 0;
+
+    for (box_idx = 0; box_idx < n_boxes; box_idx++) {
+        int box_num = box_list ? box_list[box_idx] : box_idx;
+        const Box *box = &boxes[box_num];
+        FabBoxJob proto;
+        int inside = 1;
+        for (i = 0; i < 3; i++) {
+            proto.clip_lo[i] = box->lo[i] > lo[i] ? box->lo[i] : lo[i];
+            proto.clip_hi[i] = box->hi[i] < lo[i] + dims[i] - 1 ? box->hi[i] : lo[i] + dims[i] - 1;
+            if (proto.clip_lo[i] > proto.clip_hi[i]) inside = 0;
+            proto.dims[i] = dims[i];
+            proto.lo[i] = lo[i];
+        }
+        if (!inside) continue;
+
+        /* The first component still to read leads the box */
+        FabBoxJob *lead = NULL;
+        for (c = 0; c < n_comps; c++) {
+            if (box_range_is_zero(ranges, box_num, var_idxs[c])) continue;
+            FabBoxJob *job = &jobs[n_jobs++];
+            if (!lead) {
+                FabMapping *fm = fab_map_get(set, box->filename);
+                proto.set = set;
+                proto.map_idx = (fm && (fm->base || fm->fd >= 0)) ? (int)(fm - set->maps) : -1;
+                proto.box = box;
+                proto.lead = NULL;
+                proto.located = 0;
+                proto.ok = 0;
+                *job = proto;
+                lead = job;
+            } else {
+                *job = *lead;
+                job->lead = lead;
+            }
+            job->var_idx = var_idxs[c];
+            job->dest = dests[c];
+        }
+    }
+    return n_jobs;
+}
+
+static int fab_queue_component(FabMapSet *set, const Box *boxes, const int *box_list, int n_boxes,
+                               const BoxRanges *ranges, int var_idx, double *dest,
+                               const int dims[3], const int lo[3], FabBoxJob *jobs) {
+    return fab_queue_components(set, boxes, box_list, n_boxes, ranges, &var_idx, 1, &dest,
+                                dims, lo, jobs);
+}
+
+static int fab_count_ok(const FabBoxJob *jobs, int n_jobs) {
+    int i, n = 0;
+    for (i = 0; i < n_jobs; i++) n += jobs[i].ok;
+    return n;
+}
+
+/* Read components var_idxs[0..n_comps) of every box in a level (or of the
+ * boxes in box_list) into zero-filled C-order (Z, Y, X) arrays dests[c]
+ * covering the index window [lo, lo+dims), in a single sweep over the
+ * Cell_D files. Boxes are clipped to the window, so a window one cell thick
+ * along an axis reads only that plane. Boxes are spread across the worker
+ * pool. Returns the number of box components read. */
+static int read_fab_components(const char *level_dir, const Box *boxes, const int *box_list,
+                               int n_boxes, const BoxRanges *ranges,
+                               const int *var_idxs, int n_comps,
+                               double *const *dests, const int dims[3], const int lo[3]) {
+    FabMapSet set;
+    int n_jobs, n_read;
+
+    if (n_boxes <= 0 || n_comps <= 0) return 0;
+    FabBoxJob *jobs = (FabBoxJob *)malloc((size_t)n_boxes * n_comps * sizeof(FabBoxJob));
+    if (!jobs) return 0;
+
+    memset(&set, 0, sizeof(set));
+    strncpy(set.level_dir, level_dir, MAX_PATH - 1);
+
+    n_jobs = fab_queue_components(&set, boxes, box_list, n_boxes, ranges, var_idxs, n_comps,
+                                  dests, dims, lo, jobs);
+    fab_run_jobs(jobs, n_jobs);
+    n_read = fab_count_ok(jobs, n_jobs);
+
+    fab_map_release(&set);
+    free(jobs);
+    return n_read;
+}
+
+static int read_fab_component(const char *level_dir, const Box *boxes, const int *box_list,
+                              int n_boxes, const BoxRanges *ranges, int var_idx, double *dest,
+                              const int dims[3], const int lo[3]) {
+    return read_fab_components(level_dir, boxes, box_list, n_boxes, ranges, &var_idx, 1, &dest,
+                               dims, lo);
+}
+
+/* ========== Variable Cache ========== */
+
+/* Recently loaded variable volumes keyed by (plotfile, level, variable) and
+ * validated against the level's Cell_H mtime. A volume referenced by a
+ * PlotfileData or LevelData is pinned; unpinned volumes are evicted least
+ * recently used first whenever the cache exceeds its byte budget. Cached
+ * volumes are shared and must be treated as read-only. */
+#define VAR_CACHE_MAX_ENTRIES 256
+#define VAR_CACHE_DEFAULT_MB 1024
+
+typedef struct {
+    char plotfile_dir[MAX_PATH];
+    int level;
+    int var_idx;
+    time_t stamp;               /* Cell_H mtime when loaded */
+    double *data;
+    size_t bytes;
+    PlaneIndex *index;          /* Plane summaries of data, once built */
+    int pins;                   /* Number of live references */
+    int prefetched;             /* Read ahead and not yet used */
+    unsigned long last_used;
+} VarCacheEntry;
+
+static struct {
+    pthread_mutex_t lock;
+    VarCacheEntry entries[VAR_CACHE_MAX_ENTRIES];
+    int n_entries;
+    size_t bytes;               /* Total bytes held, pinned or not */
+    size_t budget;
+    unsigned long clock;
+} var_cache = { .lock = PTHREAD_MUTEX_INITIALIZER,
+                .budget = (size_t)VAR_CACHE_DEFAULT_MB << 20 };
+
+void set_variable_cache_mb(long mb) {
+    pthread_mutex_lock(&var_cache.lock);
+    var_cache.budget = mb > 0 ? (size_t)mb << 20 : 0;
+    pthread_mutex_unlock(&var_cache.lock);
+}
+
+static size_t var_cache_budget(void) {
+    size_t budget;
+    pthread_mutex_lock(&var_cache.lock);
+    budget = var_cache.budget;
+    pthread_mutex_unlock(&var_cache.lock);
+    return budget;
+}
+
+static time_t level_cell_h_stamp(const char *plotfile_dir, int level) {
+    char path[MAX_PATH];
+    struct stat st;
+    if (level_path(path, plotfile_dir, level, "Cell_H") < 0) return 0;
+    return stat(path, &st) == 0 ? st.st_mtime : 0;
+}
+
+static void var_cache_remove_locked(int e) {
+    VarCacheEntry *ce = &var_cache.entries[e];
+    free(ce->data);
+    plane_index_free(ce->index);
+    var_cache.bytes -= ce->bytes;
+    *ce = var_cache.entries[--var_cache.n_entries];
+}
+
+/* Evict unpinned volumes until `incoming` more bytes fit the budget */
+static void var_cache_evict_locked(size_t incoming) {
+    while (var_cache.bytes + incoming > var_cache.budget) {
+        int e, victim = -1;
+        for (e = 0; e < var_cache.n_entries; e++) {
+            VarCacheEntry *ce = &var_cache.entries[e];
+            if (ce->pins > 0) continue;
+            if (victim < 0 || ce->last_used < var_cache.entries[victim].last_used) victim = e;
+        }
+        if (victim < 0) break;
+        var_cache_remove_locked(victim);
+    }
+}
+
+/* Return a pinned cached volume, or NULL on a miss */
+static double *var_cache_acquire(const char *plotfile_dir, int level, int var_idx, size_t bytes) {
+    time_t stamp = level_cell_h_stamp(plotfile_dir, level);
+    double *data = NULL;
+    int e;
+
+    pthread_mutex_lock(&var_cache.lock);
+    for (e = 0; e < var_cache.n_entries; e++) {
+        VarCacheEntry *ce = &var_cache.entries[e];
+        if (ce->level != level || ce->var_idx != var_idx ||
+            strcmp(ce->plotfile_dir, plotfile_dir) != 0) continue;
+        if (ce->stamp == stamp && ce->bytes == bytes) {
+            ce->pins++;
+            ce->prefetched = 0;
+            ce->last_used = ++var_cache.clock;
+            data = ce->data;
+            break;
         }
+        /* Plotfile was rewritten: drop the old copy, or skip it while pinned */
+        if (ce->pins == 0) var_cache_remove_locked(e--);
+    }
+    pthread_mutex_unlock(&var_cache.lock);
+    return data;
+}
 
-        free(box_data);
+/* Detach the copies of a key that a fresh insert supersedes: unpinned ones
+ * are freed, pinned ones lose their key so only var_cache_release finds them */
+static void var_cache_retire_key_locked(const char *plotfile_dir, int level, int var_idx) {
+    int e;
+
+    for (e = var_cache.n_entries - 1; e >= 0; e--) {
+        VarCacheEntry *ce = &var_cache.entries[e];
+        if (ce->level != level || ce->var_idx != var_idx ||
+            strcmp(ce->plotfile_dir, plotfile_dir) != 0) continue;
+        if (ce->pins == 0) {
+            var_cache_remove_locked(e);
+        } else {
+            ce->level = -1;
+            ce->var_idx = -1;
+        }
     }
+}
+
+/* Hand a freshly read volume to the cache, pinned once. Returns 0 if it was
+ * not cached (too large or no free slot); the caller then still owns it. */
+static int var_cache_insert(const char *plotfile_dir, int level, int var_idx,
+                            double *data, size_t bytes) {
+    int cached = 0;
+
+    pthread_mutex_lock(&var_cache.lock);
+    if (bytes <= var_cache.budget) {
+        var_cache_retire_key_locked(plotfile_dir, level, var_idx);
+        var_cache_evict_locked(bytes);
+        if (var_cache.bytes + bytes <= var_cache.budget &&
+            var_cache.n_entries < VAR_CACHE_MAX_ENTRIES) {
+            VarCacheEntry *ce = &var_cache.entries[var_cache.n_entries++];
+            strncpy(ce->plotfile_dir, plotfile_dir, MAX_PATH - 1);
+            ce->plotfile_dir[MAX_PATH - 1] = '\0';
+            ce->level = level;
+            ce->var_idx = var_idx;
+            ce->stamp = level_cell_h_stamp(plotfile_dir, level);
+            ce->data = data;
+            ce->bytes = bytes;
+            ce->index = NULL;
+            ce->pins = 1;
+            ce->prefetched = 0;
+            ce->last_used = ++var_cache.clock;
+            var_cache.bytes += bytes;
+            cached = 1;
+        }
+    }
+    pthread_mutex_unlock(&var_cache.lock);
+    return cached;
+}
+
+/* Drop a reference to a volume obtained from the reader: unpin it if it is
+ * cached, free it otherwise */
+static void var_cache_release(double *data) {
+    int e;
+
+    if (!data) return;
+    pthread_mutex_lock(&var_cache.lock);
+    for (e = 0; e < var_cache.n_entries; e++) {
+        if (var_cache.entries[e].data == data) {
+            if (var_cache.entries[e].pins > 0) var_cache.entries[e].pins--;
+            /* A retired copy goes as soon as its last user lets go */
+            if (var_cache.entries[e].pins == 0 && var_cache.entries[e].level < 0) {
+                var_cache_remove_locked(e);
+            }
+            var_cache_evict_locked(0);
+            pthread_mutex_unlock(&var_cache.lock);
+            return;
+        }
+    }
+    pthread_mutex_unlock(&var_cache.lock);
+    free(data);
+}
+
+/* Copy of the plane index kept with a cached volume, or NULL if the volume
+ * is not cached or was cached without one (read ahead) */
+static PlaneIndex *var_cache_copy_index(const double *data) {
+    PlaneIndex *index = NULL;
+    int e;
+
+    pthread_mutex_lock(&var_cache.lock);
+    for (e = 0; e < var_cache.n_entries; e++) {
+        if (var_cache.entries[e].data != data) continue;
+        index = plane_index_copy(var_cache.entries[e].index);
+        break;
+    }
+    pthread_mutex_unlock(&var_cache.lock);
+    return index;
+}
+
+/* Keep a copy of a volume's plane index with its cache entry */
+static void var_cache_store_index(const double *data, const PlaneIndex *index) {
+    int e;
+
+    if (!index) return;
+    pthread_mutex_lock(&var_cache.lock);
+    for (e = 0; e < var_cache.n_entries; e++) {
+        VarCacheEntry *ce = &var_cache.entries[e];
+        if (ce->data != data) continue;
+        if (!ce->index) ce->index = plane_index_copy(index);
+        break;
+    }
+    pthread_mutex_unlock(&var_cache.lock);
+}
+
+/* Whether a volume is worth reading ahead: not cached yet, and small enough
+ * that it cannot push more than half of the budget out of the cache */
+static int var_cache_wants_prefetch(const char *plotfile_dir, int level, int var_idx,
+                                    size_t bytes) {
+    int e, wanted;
+
+    pthread_mutex_lock(&var_cache.lock);
+    wanted = bytes > 0 && bytes <= var_cache.budget / 2;
+    for (e = 0; e < var_cache.n_entries && wanted; e++) {
+        VarCacheEntry *ce = &var_cache.entries[e];
+        if (ce->level == level && ce->var_idx == var_idx &&
+            strcmp(ce->plotfile_dir, plotfile_dir) == 0) wanted = 0;
+    }
+    pthread_mutex_unlock(&var_cache.lock);
+    return wanted;
+}
+
+/* Unpin a volume the prefetcher just inserted and mark it speculative */
+static void var_cache_park_prefetched(double *data) {
+    int e;
+
+    pthread_mutex_lock(&var_cache.lock);
+    for (e = 0; e < var_cache.n_entries; e++) {
+        VarCacheEntry *ce = &var_cache.entries[e];
+        if (ce->data != data) continue;
+        if (ce->pins > 0) ce->pins--;
+        ce->prefetched = 1;
+        break;
+    }
+    pthread_mutex_unlock(&var_cache.lock);
+}
+
+/* Free every prefetched volume that was never used */
+static void var_cache_drop_prefetched(void) {
+    int e;
+
+    pthread_mutex_lock(&var_cache.lock);
+    for (e = var_cache.n_entries - 1; e >= 0; e--) {
+        VarCacheEntry *ce = &var_cache.entries[e];
+        if (ce->prefetched && ce->pins == 0) var_cache_remove_locked(e);
+    }
+    pthread_mutex_unlock(&var_cache.lock);
+}
+
+/* Copy plane (axis, idx) of a C-order (Z, Y, X) volume into slice */
+static void extract_plane(const double *vol, const int dims[3], int axis, int idx, double *slice) {
+    int j, k;
+    int nx = dims[0], ny = dims[1], nz = dims[2];
+
+    if (axis == 2) {
+        memcpy(slice, vol + (size_t)idx * ny * nx, (size_t)ny * nx * sizeof(double));
+    } else if (axis == 1) {
+        for (k = 0; k < nz; k++) {
+            memcpy(slice + (size_t)k * nx, vol + ((size_t)k * ny + idx) * nx, nx * sizeof(double));
+        }
+    } else {
+        for (k = 0; k < nz; k++) {
+            for (j = 0; j < ny; j++) {
+                slice[(size_t)k * ny + j] = vol[((size_t)k * ny + j) * nx + idx];
+            }
+        }
+    }
+}
+
+/* Hand back pf's variable volume and its plane index */
+static void release_variable_data(PlotfileData *pf) {
+    plane_index_free(pf->plane_index);
+    pf->plane_index = NULL;
+    var_cache_release(pf->data);
+    pf->data = NULL;
+}
+
+/* Give pf->data its plane index: the cached copy when there is one,
+ * otherwise a fresh sweep that is then kept with the cached volume */
+static void attach_plane_index(PlotfileData *pf) {
+    pf->plane_index = var_cache_copy_index(pf->data);
+    if (pf->plane_index) return;
+    pf->plane_index = plane_index_build(pf->data, pf->grid_dims);
+    var_cache_store_index(pf->data, pf->plane_index);
+}
+
+/* Read variable data from all boxes */
+int read_variable_data(PlotfileData *pf, int var_idx) {
+    char level_dir[MAX_PATH];
+    size_t total_size = (size_t)pf->grid_dims[0] * pf->grid_dims[1] * pf->grid_dims[2];
+
+    /* Drop the previous variable, then try the cache */
+    release_variable_data(pf);
+    pf->data = var_cache_acquire(pf->plotfile_dir, pf->current_level, var_idx,
+                                 total_size * sizeof(double));
+    if (pf->data) {
+        attach_plane_index(pf);
+        printf("Loaded variable: %s (cached)\n", pf->variables[var_idx]);
+        return 0;
+    }
+
+    if (level_path(level_dir, pf->plotfile_dir, pf->current_level, NULL) < 0) {
+        fprintf(stderr, "Error: Path too long for level %d\n", pf->current_level);
+        return -1;
+    }
+
+    /* Allocate data array (Z, Y, X ordering) */
+    pf->data = (double *)calloc(total_size, sizeof(double));
+    if (!pf->data) {
+        fprintf(stderr, "Error: Cannot allocate memory for %s\n", pf->variables[var_idx]);
+        return -1;
+    }
+
+    /* Use relative indices by subtracting level_lo to handle non-zero level origins */
+    read_fab_component(level_dir, pf->boxes, NULL, pf->n_boxes, &pf->box_ranges, var_idx,
+                       pf->data, pf->grid_dims, pf->level_lo);
+    var_cache_insert(pf->plotfile_dir, pf->current_level, var_idx,
+                     pf->data, total_size * sizeof(double));
+    attach_plane_index(pf);
+
+    printf("Loaded variable: %s\n", pf->variables[var_idx]);
+    return 0;
+}
+
+/* Read several variables of the current level in one sweep. Cached volumes
+ * are used as they are; the others are read together and cached. Each
+ * data[v] comes back pinned (NULL if it could not be allocated) and must be
+ * handed back with var_cache_release. var_idxs must be distinct. */
+static int read_variables_data(PlotfileData *pf, const int *var_idxs, int n_vars, double **data) {
+    char level_dir[MAX_PATH];
+    size_t total_size = (size_t)pf->grid_dims[0] * pf->grid_dims[1] * pf->grid_dims[2];
+    int v, n_miss = 0, ret = 0;
+
+    int *miss_idx = (int *)malloc(n_vars * sizeof(int));
+    double **miss_data = (double **)malloc(n_vars * sizeof(double *));
+    if (!miss_idx || !miss_data) {
+        free(miss_idx);
+        free(miss_data);
+        for (v = 0; v < n_vars; v++) data[v] = NULL;
+        return -1;
+    }
+
+    for (v = 0; v < n_vars; v++) {
+        data[v] = var_cache_acquire(pf->plotfile_dir, pf->current_level, var_idxs[v],
+                                    total_size * sizeof(double));
+        if (data[v]) continue;
+        data[v] = (double *)calloc(total_size, sizeof(double));
+        if (!data[v]) {
+            fprintf(stderr, "Error: Cannot allocate memory for %s\n", pf->variables[var_idxs[v]]);
+            ret = -1;
+            continue;
+        }
+        miss_idx[n_miss] = var_idxs[v];
+        miss_data[n_miss++] = data[v];
+    }
+
+    if (n_miss > 0 && level_path(level_dir, pf->plotfile_dir, pf->current_level, NULL) < 0) {
+        fprintf(stderr, "Error: Path too long for level %d\n", pf->current_level);
+        ret = -1;
+    } else if (n_miss > 0) {
+        read_fab_components(level_dir, pf->boxes, NULL, pf->n_boxes, &pf->box_ranges,
+                            miss_idx, n_miss, miss_data, pf->grid_dims, pf->level_lo);
+        for (v = 0; v < n_miss; v++) {
+            var_cache_insert(pf->plotfile_dir, pf->current_level, miss_idx[v], miss_data[v],
+                             total_size * sizeof(double));
+        }
+    }
+    printf("Loaded %d variables (%d cached)\n", n_vars, n_vars - n_miss);
+
+    free(miss_idx);
+    free(miss_data);
+    return ret;
+}
+
+/* Read a single plane (axis, idx) of several components straight from the
+ * FABs into slices[c], laid out like extract_slice. Only the boxes crossing
+ * the plane (found through the box index) are visited, and only their
+ * intersecting rows are touched. */
+static int read_fab_slices(const char *level_dir, const Box *boxes, int n_boxes,
+                           const BoxIndex *index, const BoxRanges *ranges,
+                           const int *var_idxs, int n_vars,
+                           const int grid_dims[3], const int level_lo[3],
+                           int axis, int idx, double *const *slices) {
+    int dims[3], lo[3], i;
+
+    if (idx < 0 || idx >= grid_dims[axis]) return -1;
+    for (i = 0; i < 3; i++) {
+        dims[i] = grid_dims[i];
+        lo[i] = level_lo[i];
+    }
+    dims[axis] = 1;
+    lo[axis] += idx;
+
+    for (i = 0; i < n_vars; i++) {
+        memset(slices[i], 0, (size_t)dims[0] * dims[1] * dims[2] * sizeof(double));
+    }
+    if (n_boxes <= 0) return 0;
+
+    int *hits = (int *)malloc(n_boxes * sizeof(int));
+    if (!hits) return -1;
+    int n_hits = boxes_on_plane(boxes, n_boxes, index, axis, lo[axis], hits);
+    read_fab_components(level_dir, boxes, hits, n_hits, ranges, var_idxs, n_vars,
+                        slices, dims, lo);
+    free(hits);
+    return 0;
+}
+
+static int read_fab_slice(const char *level_dir, const Box *boxes, int n_boxes,
+                          const BoxIndex *index, const BoxRanges *ranges, int var_idx,
+                          const int grid_dims[3], const int level_lo[3],
+                          int axis, int idx, double *slice) {
+    return read_fab_slices(level_dir, boxes, n_boxes, index, ranges, &var_idx, 1,
+                           grid_dims, level_lo, axis, idx, &slice);
+}
+
+/* Read slice (axis, idx) of several variables without loading (or replacing)
+ * pf->data. Cached volumes are used when available; the remaining variables
+ * are read from the FABs together. */
+int read_variable_slices(PlotfileData *pf, const int *var_idxs, int n_vars,
+                         int axis, int idx, double **slices) {
+    char level_dir[MAX_PATH];
+    size_t total_size = (size_t)pf->grid_dims[0] * pf->grid_dims[1] * pf->grid_dims[2];
+    int miss_idx[MAX_VARS];
+    double *miss_slices[MAX_VARS];
+    int v, n_miss = 0;
+
+    if (idx < 0 || idx >= pf->grid_dims[axis] || n_vars > MAX_VARS) return -1;
+    for (v = 0; v < n_vars; v++) {
+        double *vol = var_cache_acquire(pf->plotfile_dir, pf->current_level, var_idxs[v],
+                                        total_size * sizeof(double));
+        if (vol) {
+            extract_plane(vol, pf->grid_dims, axis, idx, slices[v]);
+            var_cache_release(vol);
+        } else {
+            miss_idx[n_miss] = var_idxs[v];
+            miss_slices[n_miss++] = slices[v];
+        }
+    }
+    if (n_miss == 0) return 0;
+
+    if (level_path(level_dir, pf->plotfile_dir, pf->current_level, NULL) < 0) return -1;
+    return read_fab_slices(level_dir, pf->boxes, pf->n_boxes, &pf->box_index, &pf->box_ranges,
+                           miss_idx, n_miss, pf->grid_dims, pf->level_lo, axis, idx, miss_slices);
+}
+
+/* Read one slice of a variable without loading (or replacing) pf->data */
+int read_variable_slice(PlotfileData *pf, int var_idx, int axis, int idx, double *slice) {
+    return read_variable_slices(pf, &var_idx, 1, axis, idx, &slice);
+}
+
+/* ========== Multi-Level Overlay Functions ========== */
+
+/* Read Cell_H for a specific level into LevelData */
+int read_cell_h_level(PlotfileData *pf, int level) {
+    char path[MAX_PATH];
+    int level_lo[3], level_hi[3];
+    int i;
+    LevelData *ld = &pf->levels[level];
+
+    if (level_path(path, pf->plotfile_dir, level, "Cell_H") < 0) return -1;
+    if (load_cell_h(path, pf->ndim, &ld->boxes, &ld->cap_boxes, &ld->n_boxes,
+                    level_lo, level_hi, &ld->box_ranges) < 0) {
+        return -1;
+    }
+    box_index_build(&ld->box_index, ld->boxes, ld->n_boxes);
+
+    /* Store level bounds and grid dimensions */
+    for (i = 0; i < pf->ndim; i++) {
+        ld->level_lo[i] = level_lo[i];
+        ld->level_hi[i] = level_hi[i];
+        ld->grid_dims[i] = level_hi[i] - level_lo[i] + 1;
+    }
+    normalize_level_dims(pf, ld);
+
+    printf("Level %d overlay: Found %d boxes, Grid: %d x %d x %d (lo: %d,%d,%d)\n",
+           level, ld->n_boxes,
+           ld->grid_dims[0], ld->grid_dims[1], ld->grid_dims[2],
+           ld->level_lo[0], ld->level_lo[1], ld->level_lo[2]);
+    return 0;
+}
+
+/* Read variable data for a specific level into LevelData */
+int read_variable_data_level(PlotfileData *pf, int var_idx, int level) {
+    char level_dir[MAX_PATH];
+    LevelData *ld = &pf->levels[level];
+
+    size_t total_size = (size_t)ld->grid_dims[0] * ld->grid_dims[1] * ld->grid_dims[2];
+
+    /* Drop the previous variable, then try the cache */
+    var_cache_release(ld->data);
+    ld->data = var_cache_acquire(pf->plotfile_dir, level, var_idx, total_size * sizeof(double));
+    if (ld->data) {
+        ld->loaded = 1;
+        printf("Loaded level %d: %s (cached)\n", level, pf->variables[var_idx]);
+        return 0;
+    }
+
+    if (level_path(level_dir, pf->plotfile_dir, level, NULL) < 0) {
+        fprintf(stderr, "Error: Path too long for level %d\n", level);
+        return -1;
+    }
+
+    /* Allocate data array */
+    ld->data = (double *)calloc(total_size, sizeof(double));
+    if (!ld->data) {
+        fprintf(stderr, "Error: Cannot allocate memory for level %d\n", level);
+        return -1;
+    }
+
+    /* Insert into level array using relative indices */
+    read_fab_component(level_dir, ld->boxes, NULL, ld->n_boxes, &ld->box_ranges, var_idx,
+                       ld->data, ld->grid_dims, ld->level_lo);
+    var_cache_insert(pf->plotfile_dir, level, var_idx, ld->data, total_size * sizeof(double));
 
     ld->loaded = 1;
     printf("Loaded level %d: %s\n", level, pf->variables[var_idx]);
     return 0;
 }
 
-/* Load all levels for overlay rendering */
+/* Read one slice of a variable at a specific level without touching ld->data */
+int read_variable_slice_level(PlotfileData *pf, int var_idx, int level, int axis, int idx,
+                              double *slice) {
+    char level_dir[MAX_PATH];
+    LevelData *ld = &pf->levels[level];
+    size_t total_size = (size_t)ld->grid_dims[0] * ld->grid_dims[1] * ld->grid_dims[2];
+
+    if (idx < 0 || idx >= ld->grid_dims[axis]) return -1;
+    double *vol = var_cache_acquire(pf->plotfile_dir, level, var_idx, total_size * sizeof(double));
+    if (vol) {
+        extract_plane(vol, ld->grid_dims, axis, idx, slice);
+        var_cache_release(vol);
+        return 0;
+    }
+
+    if (level_path(level_dir, pf->plotfile_dir, level, NULL) < 0) return -1;
+    return read_fab_slice(level_dir, ld->boxes, ld->n_boxes, &ld->box_index, &ld->box_ranges,
+                          var_idx, ld->grid_dims, ld->level_lo, axis, idx, slice);
+}
+
+/* Load all levels for overlay rendering. Boxes from every level go into a
+ * single pool dispatch, so levels are read concurrently. */
 int load_all_levels(PlotfileData *pf, int var_idx) {
     int level;
     int loaded_count = 0;
+    int total_boxes = 0, n_jobs = 0;
+    int cell_h_ok[MAX_LEVELS];
+    int queued[MAX_LEVELS];     /* 1 = read from disk, 2 = served from cache */
+    FabMapSet sets[MAX_LEVELS];
 
     printf("load_all_levels: Loading %d levels for var %d\n", pf->n_levels, var_idx);
 
+    memset(sets, 0, sizeof(sets));
+    memset(cell_h_ok, 0, sizeof(cell_h_ok));
+    memset(queued, 0, sizeof(queued));
+
     for (level = 0; level < pf->n_levels && level < MAX_LEVELS; level++) {
         /* Always read Cell_H for this level to ensure fresh data */
         if (read_cell_h_level(pf, level) < 0) {
             fprintf(stderr, "Warning: Cannot read Cell_H for level %d\n", level);
             continue;
         }
+        cell_h_ok[level] = 1;
+        total_boxes += pf->levels[level].n_boxes;
+    }
+
+    FabBoxJob *jobs = (FabBoxJob *)malloc((total_boxes > 0 ? total_boxes : 1) * sizeof(FabBoxJob));
+    if (!jobs) {
+        fprintf(stderr, "Error: Cannot allocate level read jobs\n");
+        return -1;
+    }
+
+    for (level = 0; level < pf->n_levels && level < MAX_LEVELS; level++) {
+        LevelData *ld = &pf->levels[level];
+        if (!cell_h_ok[level]) continue;
+
+        /* Drop the previous variable, then try the cache */
+        size_t total_size = (size_t)ld->grid_dims[0] * ld->grid_dims[1] * ld->grid_dims[2];
+        var_cache_release(ld->data);
+        ld->data = var_cache_acquire(pf->plotfile_dir, level, var_idx, total_size * sizeof(double));
+        if (ld->data) {
+            queued[level] = 2;
+            continue;
+        }
+
+        if (level_path(sets[level].level_dir, pf->plotfile_dir, level, NULL) < 0) continue;
 
-        /* Read variable data for this level */
-        if (read_variable_data_level(pf, var_idx, level) < 0) {
+        /* Allocate data array */
+        ld->data = (double *)calloc(total_size, sizeof(double));
+        if (!ld->data) {
             fprintf(stderr, "Warning: Cannot load variable for level %d\n", level);
             continue;
         }
 
+        n_jobs += fab_queue_component(&sets[level], ld->boxes, NULL, ld->n_boxes,
+                                      &ld->box_ranges, var_idx, ld->data, ld->grid_dims,
+                                      ld->level_lo, jobs + n_jobs);
+        queued[level] = 1;
+    }
+
+    fab_run_jobs(jobs, n_jobs);
+
+    for (level = 0; level < pf->n_levels && level < MAX_LEVELS; level++) {
+        LevelData *ld = &pf->levels[level];
+        if (!queued[level]) continue;
+        if (queued[level] == 1) {
+            size_t total_size = (size_t)ld->grid_dims[0] * ld->grid_dims[1] * ld->grid_dims[2];
+            fab_map_release(&sets[level]);
+            var_cache_insert(pf->plotfile_dir, level, var_idx, ld->data,
+                             total_size * sizeof(double));
+        }
+        ld->loaded = 1;
+        printf("Loaded level %d: %s%s\n", level, pf->variables[var_idx],
+               queued[level] == 2 ? " (cached)" : "");
         loaded_count++;
     }
+    free(jobs);
 
     printf("Loaded %d of %d levels for overlay\n", loaded_count, pf->n_levels);
     return 0;
@@ -1756,11 +4072,12 @@ void free_all_levels(PlotfileData *pf) {
     int level, i;
     for (level = 0; level < MAX_LEVELS; level++) {
         if (pf->levels[level].data) {
-            free(pf->levels[level].data);
+            var_cache_release(pf->levels[level].data);
             pf->levels[level].data = NULL;
         }
         pf->levels[level].loaded = 0;
         pf->levels[level].n_boxes = 0;
+        box_ranges_free(&pf->levels[level].box_ranges);
         /* Clear all fields to prevent stale data issues */
         for (i = 0; i < 3; i++) {
             pf->levels[level].grid_dims[i] = 0;
@@ -1770,6 +4087,384 @@ void free_all_levels(PlotfileData *pf) {
     }
 }
 
+/* ========== Geo Slice Cache ========== */
+
+/* Map mode places every cell at its geographic coordinates, read from the
+ * lon_m/lat_m variables of the displayed plane. Those planes are kept here
+ * per (plotfile, level, axis, slice) together with their extent and the
+ * corner mesh the rasterizer fills, so zoom, pan, hover and colormap
+ * changes only reproject it. Only the GUI thread renders, so the cache has
+ * no lock. */
+#define GEO_SLICE_CACHE_ENTRIES 16
+
+typedef struct {
+    char plotfile_dir[MAX_PATH];
+    int level, axis, slice_idx;
+    int x_var, y_var;           /* y_var < 0: y is the physical Z of each row */
+    double z0, dz;              /* Row j sits at z0 + (j + 0.5) * dz */
+    int width, height;
+    time_t stamp;               /* Cell_H mtime when read */
+    double *x, *y;              /* Screen-axis coordinate of each cell */
+    double x_min, x_max, y_min, y_max;
+    /* Cell corners, (width + 1) x (height + 1), and the y range of each row
+     * of cells, all in data units; NULL when the plane has no mesh */
+    double *corner_x, *corner_y;
+    double *strip_lo, *strip_hi;
+    unsigned long last_used;
+} GeoSlice;
+
+static GeoSlice geo_slices[GEO_SLICE_CACHE_ENTRIES];
+static unsigned long geo_slice_clock = 0;
+
+static void geo_slice_free(GeoSlice *gs) {
+    free(gs->x);
+    free(gs->y);
+    free(gs->corner_x);
+    free(gs->corner_y);
+    free(gs->strip_lo);
+    free(gs->strip_hi);
+    memset(gs, 0, sizeof(*gs));
+}
+
+/* Centre (i, j) of a width x height grid, extended one cell past each edge
+ * by linear extrapolation (columns first, then rows) */
+static double geo_mesh_centre(const double *c, int width, int height, int i, int j) {
+    if (j < 0) {
+        return 2 * geo_mesh_centre(c, width, height, i, 0) - geo_mesh_centre(c, width, height, i, 1);
+    }
+    if (j >= height) {
+        return 2 * geo_mesh_centre(c, width, height, i, height - 1)
+             - geo_mesh_centre(c, width, height, i, height - 2);
+    }
+    const double *row = c + (size_t)j * width;
+    if (i < 0) return 2 * row[0] - row[1];
+    if (i >= width) return 2 * row[width - 1] - row[width - 2];
+    return row[i];
+}
+
+/* Corner (i, j) lies between extended centres (i-1..i, j-1..j). Corners are
+ * kept in data units: the canvas mapping is affine, so projecting them per
+ * frame gives the same mesh as averaging projected centres. */
+static void geo_slice_build_mesh(GeoSlice *gs) {
+    int w = gs->width, h = gs->height, cw = w + 1, i, j;
+
+    if (w < 2 || h < 2) return;
+    size_t n = (size_t)cw * (h + 1);
+    gs->corner_x = (double *)malloc(n * sizeof(double));
+    gs->corner_y = (double *)malloc(n * sizeof(double));
+    gs->strip_lo = (double *)malloc(h * sizeof(double));
+    gs->strip_hi = (double *)malloc(h * sizeof(double));
+    if (!gs->corner_x || !gs->corner_y || !gs->strip_lo || !gs->strip_hi) {
+        free(gs->corner_x);
+        free(gs->corner_y);
+        free(gs->strip_lo);
+        free(gs->strip_hi);
+        gs->corner_x = gs->corner_y = gs->strip_lo = gs->strip_hi = NULL;
+        return;
+    }
+
+    for (j = 0; j <= h; j++) {
+        for (i = 0; i <= w; i++) {
+            int interior = i > 0 && i < w && j > 0 && j < h;
+            size_t a = (size_t)(j - 1) * w + i - 1, b = a + w;
+            double *cx = &gs->corner_x[(size_t)j * cw + i], *cy = &gs->corner_y[(size_t)j * cw + i];
+            if (interior) {
+                *cx = 0.25 * (gs->x[a] + gs->x[a + 1] + gs->x[b] + gs->x[b + 1]);
+                *cy = 0.25 * (gs->y[a] + gs->y[a + 1] + gs->y[b] + gs->y[b + 1]);
+            } else {
+                *cx = 0.25 * (geo_mesh_centre(gs->x, w, h, i - 1, j - 1)
+                            + geo_mesh_centre(gs->x, w, h, i, j - 1)
+                            + geo_mesh_centre(gs->x, w, h, i - 1, j)
+                            + geo_mesh_centre(gs->x, w, h, i, j));
+                *cy = 0.25 * (geo_mesh_centre(gs->y, w, h, i - 1, j - 1)
+                            + geo_mesh_centre(gs->y, w, h, i, j - 1)
+                            + geo_mesh_centre(gs->y, w, h, i - 1, j)
+                            + geo_mesh_centre(gs->y, w, h, i, j));
+            }
+        }
+    }
+    for (j = 0; j < h; j++) {
+        const double *cy = gs->corner_y + (size_t)j * cw;
+        double lo = cy[0], hi = lo;
+        for (i = 0; i < 2 * cw; i++) {
+            if (cy[i] < lo) lo = cy[i];
+            if (cy[i] > hi) hi = cy[i];
+        }
+        gs->strip_lo[j] = lo;
+        gs->strip_hi[j] = hi;
+    }
+}
+
+/* Coordinates of plane slice_idx along axis at level, from the cache or
+ * read once: x from variable x_var, y from y_var or from (z0, dz). The
+ * result stays valid until the next call; NULL if the read failed. */
+static const GeoSlice *geo_slice_get(PlotfileData *pf, int level, int x_var, int y_var,
+                                     int axis, int slice_idx, int width, int height,
+                                     double z0, double dz) {
+    time_t stamp = level_cell_h_stamp(pf->plotfile_dir, level);
+    size_t k, n = (size_t)width * height;
+    GeoSlice *gs = NULL;
+    int e, i, j, ret;
+
+    if (n == 0) return NULL;
+
+    for (e = 0; e < GEO_SLICE_CACHE_ENTRIES; e++) {
+        GeoSlice *c = &geo_slices[e];
+        if (!c->x || c->level != level || c->axis != axis || c->slice_idx != slice_idx ||
+            c->x_var != x_var || c->y_var != y_var || c->width != width ||
+            c->height != height || strcmp(c->plotfile_dir, pf->plotfile_dir) != 0) continue;
+        if (y_var < 0 && (c->z0 != z0 || c->dz != dz)) continue;
+        if (c->stamp == stamp) {
+            c->last_used = ++geo_slice_clock;
+            return c;
+        }
+        geo_slice_free(c);  /* Plotfile was rewritten */
+    }
+
+    /* Miss: reuse a free slot or the least recently used one */
+    for (e = 0; e < GEO_SLICE_CACHE_ENTRIES; e++) {
+        GeoSlice *c = &geo_slices[e];
+        if (!c->x) { gs = c; break; }
+        if (!gs || c->last_used < gs->last_used) gs = c;
+    }
+    geo_slice_free(gs);
+
+    double *x = (double *)malloc(n * sizeof(double));
+    double *y = (double *)malloc(n * sizeof(double));
+    if (!x || !y) {
+        free(x);
+        free(y);
+        return NULL;
+    }
+    if (level == pf->current_level && y_var >= 0) {
+        int vars[2] = { x_var, y_var };
+        double *slices[2] = { x, y };
+        ret = read_variable_slices(pf, vars, 2, axis, slice_idx, slices);
+    } else if (level == pf->current_level) {
+        ret = read_variable_slice(pf, x_var, axis, slice_idx, x);
+    } else {
+        ret = read_variable_slice_level(pf, x_var, level, axis, slice_idx, x);
+        if (ret == 0 && y_var >= 0) {
+            ret = read_variable_slice_level(pf, y_var, level, axis, slice_idx, y);
+        }
+    }
+    if (ret < 0) {
+        free(x);
+        free(y);
+        return NULL;
+    }
+    if (y_var < 0) {
+        for (j = 0; j < height; j++) {
+            double z = z0 + (j + 0.5) * dz;
+            for (i = 0; i < width; i++) y[(size_t)j * width + i] = z;
+        }
+    }
+
+    strncpy(gs->plotfile_dir, pf->plotfile_dir, MAX_PATH - 1);
+    gs->plotfile_dir[MAX_PATH - 1] = '\0';
+    gs->level = level;
+    gs->axis = axis;
+    gs->slice_idx = slice_idx;
+    gs->x_var = x_var;
+    gs->y_var = y_var;
+    gs->z0 = z0;
+    gs->dz = dz;
+    gs->width = width;
+    gs->height = height;
+    gs->stamp = stamp;
+    gs->x = x;
+    gs->y = y;
+    gs->x_min = gs->x_max = x[0];
+    gs->y_min = gs->y_max = y[0];
+    for (k = 0; k < n; k++) {
+        if (x[k] < gs->x_min) gs->x_min = x[k];
+        if (x[k] > gs->x_max) gs->x_max = x[k];
+        if (y[k] < gs->y_min) gs->y_min = y[k];
+        if (y[k] > gs->y_max) gs->y_max = y[k];
+    }
+    geo_slice_build_mesh(gs);
+    gs->last_used = ++geo_slice_clock;
+    return gs;
+}
+
+/* ========== Timestep Prefetch ========== */
+
+/* While the user steps through time, a background thread reads the current
+ * variable of the neighbouring timesteps into the variable cache, the next
+ * one in the stepping direction first. Boxes are read serially so the
+ * prefetcher never holds the worker pool the foreground reader needs, and
+ * every new request or cancel abandons the work in flight. */
+#define PREFETCH_MAX_TARGETS 2
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cv;
+    int started;
+    unsigned long generation;   /* Bumped by every request and cancel */
+    char targets[PREFETCH_MAX_TARGETS][MAX_PATH];
+    int n_targets;
+    int level;
+    int var_idx;
+    int ndim;
+    int direction;              /* +1 stepping forward, -1 backward */
+} prefetch = { .lock = PTHREAD_MUTEX_INITIALIZER, .cv = PTHREAD_COND_INITIALIZER,
+               .direction = 1 };
+
+static int prefetch_is_stale(unsigned long generation) {
+    int stale;
+    pthread_mutex_lock(&prefetch.lock);
+    stale = prefetch.generation != generation;
+    pthread_mutex_unlock(&prefetch.lock);
+    return stale;
+}
+
+/* Read one volume into the cache as an unpinned, speculative entry */
+static void prefetch_volume(const char *plotfile_dir, int level, int var_idx, int ndim,
+                            unsigned long generation) {
+    char path[MAX_PATH];
+    struct stat st;
+    Box *boxes = NULL;
+    BoxRanges ranges;
+    int cap_boxes = 0, n_boxes = 0;
+    int level_lo[3], level_hi[3], dims[3] = {1, 1, 1}, lo[3] = {0, 0, 0};
+    int i, n_jobs;
+    FabMapSet set;
+
+    memset(&set, 0, sizeof(set));
+    if (level_path(path, plotfile_dir, level, "Cell_H") < 0 ||
+        level_path(set.level_dir, plotfile_dir, level, NULL) < 0) {
+        return;
+    }
+    if (stat(path, &st) != 0) return;  /* Level not present at this timestep */
+    memset(&ranges, 0, sizeof(ranges));
+    if (load_cell_h(path, ndim, &boxes, &cap_boxes, &n_boxes, level_lo, level_hi, &ranges) < 0 ||
+        n_boxes <= 0) {
+        free(boxes);
+        box_ranges_free(&ranges);
+        return;
+    }
+    for (i = 0; i < ndim; i++) {
+        lo[i] = level_lo[i];
+        dims[i] = level_hi[i] - level_lo[i] + 1;
+    }
+
+    size_t bytes = (size_t)dims[0] * dims[1] * dims[2] * sizeof(double);
+    double *vol = NULL;
+    FabBoxJob *jobs = NULL;
+    if (var_cache_wants_prefetch(plotfile_dir, level, var_idx, bytes)) {
+        vol = (double *)calloc(1, bytes);
+        jobs = (FabBoxJob *)malloc(n_boxes * sizeof(FabBoxJob));
+    }
+    if (!vol || !jobs) {
+        free(vol);
+        free(jobs);
+        free(boxes);
+        box_ranges_free(&ranges);
+        return;
+    }
+
+    n_jobs = fab_queue_component(&set, boxes, NULL, n_boxes, &ranges, var_idx, vol, dims, lo,
+                                 jobs);
+    for (i = 0; i < n_jobs && !prefetch_is_stale(generation); i++) {
+        fab_box_job_locate(jobs, i);
+    }
+    int complete = 0;
+    FabReadPlan plan;
+    if (i == n_jobs && fab_plan_reads(jobs, n_jobs, &plan) == 0) {
+        fab_advise_plan(&plan);
+        for (i = 0; i < plan.n_runs && !prefetch_is_stale(generation); i++) {
+            fab_read_run(&plan, i);
+        }
+        complete = (i == plan.n_runs);
+        fab_plan_free(&plan);
+    }
+    fab_map_release(&set);
+    free(jobs);
+    free(boxes);
+    box_ranges_free(&ranges);
+
+    /* Publish under the prefetch lock so a concurrent cancel either drops the
+     * entry afterwards or makes us discard it here */
+    pthread_mutex_lock(&prefetch.lock);
+    if (complete && prefetch.generation == generation &&
+        var_cache_insert(plotfile_dir, level, var_idx, vol, bytes)) {
+        var_cache_park_prefetched(vol);
+        vol = NULL;
+    }
+    pthread_mutex_unlock(&prefetch.lock);
+    free(vol);
+}
+
+static void *prefetch_main(void *arg) {
+    char plotfile_dir[MAX_PATH];
+    (void)arg;
+
+    pthread_mutex_lock(&prefetch.lock);
+    for (;;) {
+        while (prefetch.n_targets == 0) pthread_cond_wait(&prefetch.cv, &prefetch.lock);
+
+        memcpy(plotfile_dir, prefetch.targets[0], MAX_PATH);
+        prefetch.n_targets--;
+        memmove(prefetch.targets[0], prefetch.targets[1], (size_t)prefetch.n_targets * MAX_PATH);
+        int level = prefetch.level;
+        int var_idx = prefetch.var_idx;
+        int ndim = prefetch.ndim;
+        unsigned long generation = prefetch.generation;
+
+        pthread_mutex_unlock(&prefetch.lock);
+        prefetch_volume(plotfile_dir, level, var_idx, ndim, generation);
+        pthread_mutex_lock(&prefetch.lock);
+    }
+    return NULL;
+}
+
+/* Queue the timesteps around the current one for the current level and
+ * variable. step is the last move through time (+1/-1); 0 keeps the
+ * previous direction. */
+void prefetch_neighbour_timesteps(PlotfileData *pf, int step) {
+    int candidates[2], c, i;
+
+    if (n_timesteps < 2) return;
+
+    pthread_mutex_lock(&prefetch.lock);
+    if (step != 0) prefetch.direction = step > 0 ? 1 : -1;
+    candidates[0] = (current_timestep + prefetch.direction + n_timesteps) % n_timesteps;
+    candidates[1] = (current_timestep - prefetch.direction + n_timesteps) % n_timesteps;
+
+    prefetch.generation++;
+    prefetch.n_targets = 0;
+    for (c = 0; c < 2; c++) {
+        if (c == 1 && candidates[1] == candidates[0]) break;
+        i = prefetch.n_targets++;
+        strncpy(prefetch.targets[i], timestep_paths[candidates[c]], MAX_PATH - 1);
+        prefetch.targets[i][MAX_PATH - 1] = '\0';
+    }
+    prefetch.level = pf->current_level;
+    prefetch.var_idx = pf->current_var;
+    prefetch.ndim = pf->ndim;
+
+    if (!prefetch.started) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, prefetch_main, NULL) == 0) {
+            pthread_detach(thread);
+            prefetch.started = 1;
+        } else {
+            prefetch.n_targets = 0;
+        }
+    }
+    pthread_cond_signal(&prefetch.cv);
+    pthread_mutex_unlock(&prefetch.lock);
+}
+
+/* Abandon queued and in-flight prefetches and drop unused prefetched volumes */
+void prefetch_cancel(void) {
+    pthread_mutex_lock(&prefetch.lock);
+    prefetch.generation++;
+    prefetch.n_targets = 0;
+    pthread_mutex_unlock(&prefetch.lock);
+    var_cache_drop_prefetched();
+}
+
 /* ========== SDM (Super Droplet Moisture) Functions ========== */
 
 /* Read particle Header from super_droplets_moisture subdirectory */
@@ -2287,56 +4982,193 @@ const char *get_variable_unit(const char *varname) {
     return "";  /* Unknown - no unit */
 }
 
-/* Apply colormap to data with scale_mode support */
+/* ========== Colormap Lookup Tables ========== */
+
+/* Each colormap is sampled once into a table of pixel values in the
+ * visual's native format, so coloring a slice is normalize -> index ->
+ * load, with no per-pixel colormap evaluation */
+#define N_COLORMAPS 8
+#define COLORMAP_LUT_SIZE 4096
+
+static uint32_t colormap_luts[N_COLORMAPS][COLORMAP_LUT_SIZE];
+static int colormap_lut_ready[N_COLORMAPS];
+
+/* Pixel value of an RGB color for the default visual. Falls back to
+ * 0xRRGGBB before the display is open. */
+static unsigned long rgb_pixel(unsigned char r, unsigned char g, unsigned char b) {
+    static int init = 0;
+    static int shift[3], bits[3];
+    int c;
+
+    if (!display) return ((unsigned long)r << 16) | ((unsigned long)g << 8) | b;
+    if (!init) {
+        Visual *visual = DefaultVisual(display, screen);
+        unsigned long masks[3] = {visual->red_mask, visual->green_mask, visual->blue_mask};
+        for (c = 0; c < 3; c++) {
+            unsigned long m = masks[c];
+            shift[c] = 0;
+            bits[c] = 0;
+            if (!m) continue;
+            while (!(m & 1)) { m >>= 1; shift[c]++; }
+            while (m & 1) { m >>= 1; bits[c]++; }
+        }
+        init = 1;
+    }
+    if (bits[0] == 0) return ((unsigned long)r << 16) | ((unsigned long)g << 8) | b;
+
+    unsigned long pixel = 0;
+    unsigned char rgb[3] = {r, g, b};
+    for (c = 0; c < 3; c++) {
+        unsigned long v = bits[c] <= 8 ? (unsigned long)rgb[c] >> (8 - bits[c])
+                                       : (unsigned long)rgb[c] << (bits[c] - 8);
+        pixel |= v << shift[c];
+    }
+    return pixel;
+}
+
+static const uint32_t *colormap_lut(int cmap_type) {
+    int k;
+    if (cmap_type < 0 || cmap_type >= N_COLORMAPS) cmap_type = 0;
+    if (!colormap_lut_ready[cmap_type]) {
+        for (k = 0; k < COLORMAP_LUT_SIZE; k++) {
+            RGB color = get_colormap_rgb((double)k / (COLORMAP_LUT_SIZE - 1), cmap_type);
+            colormap_luts[cmap_type][k] = (uint32_t)rgb_pixel(color.r, color.g, color.b);
+        }
+        colormap_lut_ready[cmap_type] = 1;
+    }
+    return colormap_luts[cmap_type];
+}
+
+#define COLORMAP_LINEAR 0
+#define COLORMAP_LOG_POS 1
+#define COLORMAP_LOG_NEG 2
+
+#if defined(__AVX2__) && __SIZEOF_LONG__ == 8
+/* log2 of 4 positive finite doubles: exponent plus an odd series in
+ * s = (m - 1) / (m + 1) for the mantissa m in [sqrt(1/2), sqrt(2)),
+ * accurate to ~1e-8, far below one table step */
+static inline __m256d colormap_log2_pd(__m256d x) {
+    const __m256i mant_mask = _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL);
+    const __m256i one_bits = _mm256_set1_epi64x(0x3FF0000000000000LL);
+    const __m256i magic_bits = _mm256_set1_epi64x(0x4330000000000000LL);  /* 2^52 */
+    const __m256d magic = _mm256_set1_pd(4503599627370496.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+
+    __m256i bits = _mm256_castpd_si256(x);
+    __m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, mant_mask), one_bits));
+    __m256d e = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 52),
+                                                                  magic_bits)), magic);
+    __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(1.4142135623730951), _CMP_GT_OQ);
+    m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big);
+    e = _mm256_add_pd(_mm256_sub_pd(e, _mm256_set1_pd(1023.0)), _mm256_and_pd(big, one));
+
+    __m256d s = _mm256_div_pd(_mm256_sub_pd(m, one), _mm256_add_pd(m, one));
+    __m256d s2 = _mm256_mul_pd(s, s);
+    __m256d poly = _mm256_set1_pd(2.0 / 11.0);
+    poly = _mm256_add_pd(_mm256_mul_pd(poly, s2), _mm256_set1_pd(2.0 / 9.0));
+    poly = _mm256_add_pd(_mm256_mul_pd(poly, s2), _mm256_set1_pd(2.0 / 7.0));
+    poly = _mm256_add_pd(_mm256_mul_pd(poly, s2), _mm256_set1_pd(2.0 / 5.0));
+    poly = _mm256_add_pd(_mm256_mul_pd(poly, s2), _mm256_set1_pd(2.0 / 3.0));
+    poly = _mm256_add_pd(_mm256_mul_pd(poly, s2), _mm256_set1_pd(2.0));
+    poly = _mm256_mul_pd(_mm256_mul_pd(poly, s), _mm256_set1_pd(1.4426950408889634));  /* 1/ln 2 */
+    return _mm256_add_pd(e, poly);
+}
+#endif
+
+/* Color n values: index = x * scale + bias, clamped to the table, where x
+ * is the value (linear) or log2 of its magnitude (log modes). Values the
+ * log modes cannot show (wrong sign, NaN) get the `invalid` pixel. Inlined
+ * per mode so each scale gets its own loop. */
+static inline __attribute__((always_inline))
+void colormap_kernel(const double *data, size_t n, unsigned long *pixels, const uint32_t *lut,
+                     double scale, double bias, unsigned long invalid, int mode) {
+    const double top = COLORMAP_LUT_SIZE - 1;
+    size_t i = 0;
+#if defined(__AVX2__) && __SIZEOF_LONG__ == 8
+    const __m256d vscale = _mm256_set1_pd(scale);
+    const __m256d vbias = _mm256_set1_pd(bias);
+    const __m256d vzero = _mm256_setzero_pd();
+    const __m256d vtop = _mm256_set1_pd(top);
+    const __m256d vtiny = _mm256_set1_pd(1e-300);
+    const __m256i vinvalid = _mm256_set1_epi64x((long long)invalid);
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(data + i);
+        __m256d x = v, valid = vzero;
+        if (mode == COLORMAP_LOG_POS) {
+            valid = _mm256_cmp_pd(v, vzero, _CMP_GT_OQ);
+            x = colormap_log2_pd(_mm256_max_pd(v, vtiny));
+        } else if (mode == COLORMAP_LOG_NEG) {
+            valid = _mm256_cmp_pd(v, vzero, _CMP_LT_OQ);
+            x = colormap_log2_pd(_mm256_max_pd(_mm256_sub_pd(vzero, v), vtiny));
+        }
+        /* max/min return the second operand for NaN, so NaN lands on 0 */
+        __m256d f = _mm256_add_pd(_mm256_mul_pd(x, vscale), vbias);
+        f = _mm256_min_pd(_mm256_max_pd(f, vzero), vtop);
+        __m128i idx = _mm256_cvttpd_epi32(f);
+        __m256i px = _mm256_cvtepu32_epi64(_mm_i32gather_epi32((const int *)lut, idx, 4));
+        if (mode != COLORMAP_LINEAR) {
+            px = _mm256_blendv_epi8(vinvalid, px, _mm256_castpd_si256(valid));
+        }
+        _mm256_storeu_si256((__m256i *)(pixels + i), px);
+    }
+#endif
+    for (; i < n; i++) {
+        double v = data[i], x = v;
+        if (mode == COLORMAP_LOG_POS) {
+            if (!(v > 0)) { pixels[i] = invalid; continue; }
+            x = log2(v);
+        } else if (mode == COLORMAP_LOG_NEG) {
+            if (!(v < 0)) { pixels[i] = invalid; continue; }
+            x = log2(-v);
+        }
+        double f = x * scale + bias;
+        if (!(f > 0)) f = 0;
+        if (f > top) f = top;
+        pixels[i] = lut[(int)f];
+    }
+}
+
+/* Apply colormap to data with scale_mode support. Log(+) shows values
+ * above zero on a log scale between vmin and vmax (gray otherwise); Log(-)
+ * does the same for the magnitudes of negative values. */
 void apply_colormap(double *data, int width, int height,
                    unsigned long *pixels, double vmin, double vmax, int cmap_type) {
-    int i, j;
-    double range = vmax - vmin;
-    if (range < 1e-10) range = 1.0;
-
-    for (j = 0; j < height; j++) {
-        for (i = 0; i < width; i++) {
-            double val = data[j * width + i];
-            double t;
-
-            if (scale_mode == 0) {  /* Linear */
-                t = (val - vmin) / range;
-            } else if (scale_mode == 1) {  /* Log(+) */
-                if (val <= 0) {
-                    pixels[j * width + i] = 0xC0C0C0;  /* Gray for non-positive */
-                    continue;
-                }
-                /* Map log(val) to [0,1] using log(vmin) to log(vmax) */
-                double log_vmin = (vmin > 0) ? log10(vmin) : log10(1e-10);
-                double log_vmax = (vmax > 0) ? log10(vmax) : log10(1e-10);
-                if (log_vmax - log_vmin < 1e-10) {
-                    t = 0.5;
-                } else {
-                    t = (log10(val) - log_vmin) / (log_vmax - log_vmin);
-                }
-            } else {  /* Log(-) for scale_mode == 2 */
-                if (val >= 0) {
-                    pixels[j * width + i] = 0xC0C0C0;  /* Gray for non-negative */
-                    continue;
-                }
-                /* Use absolute value, flip the range */
-                double abs_val = -val;
-                double abs_vmax = (vmin < 0) ? -vmin : 1e-10;
-                double abs_vmin = (vmax < 0) ? -vmax : 1e-10;
-                double log_vmin = log10(abs_vmin > 0 ? abs_vmin : 1e-10);
-                double log_vmax = log10(abs_vmax > 0 ? abs_vmax : 1e-10);
-                if (log_vmax - log_vmin < 1e-10) {
-                    t = 0.5;
-                } else {
-                    t = (log10(abs_val) - log_vmin) / (log_vmax - log_vmin);
-                }
-            }
+    const uint32_t *lut = colormap_lut(cmap_type);
+    const double top = COLORMAP_LUT_SIZE - 1;
+    size_t n = (size_t)width * height;
+    unsigned long gray = rgb_pixel(0xC0, 0xC0, 0xC0);
+
+    if (scale_mode == 0) {  /* Linear */
+        double range = vmax - vmin;
+        if (range < 1e-10) range = 1.0;
+        double scale = top / range;
+        /* +0.5 rounds to the nearest table entry */
+        colormap_kernel(data, n, pixels, lut, scale, 0.5 - vmin * scale, gray, COLORMAP_LINEAR);
+        return;
+    }
 
-            if (t < 0) t = 0;
-            if (t > 1) t = 1;
-            RGB color = get_colormap_rgb(t, cmap_type);
-            pixels[j * width + i] = (color.r << 16) | (color.g << 8) | color.b;
-        }
+    /* Log bounds are computed once, in log2 (same t as with log10) */
+    double lo, hi;
+    if (scale_mode == 1) {  /* Log(+) */
+        lo = vmin > 0 ? vmin : 1e-10;
+        hi = vmax > 0 ? vmax : 1e-10;
+    } else {  /* Log(-): magnitudes, range flipped */
+        lo = vmax < 0 ? -vmax : 1e-10;
+        hi = vmin < 0 ? -vmin : 1e-10;
+    }
+    double scale, bias;
+    if (log10(hi) - log10(lo) < 1e-10) {
+        scale = 0.0;
+        bias = 0.5 * top + 0.5;
+    } else {
+        double log_lo = log2(lo);
+        scale = top / (log2(hi) - log_lo);
+        bias = 0.5 - log_lo * scale;
+    }
+    if (scale_mode == 1) {
+        colormap_kernel(data, n, pixels, lut, scale, bias, gray, COLORMAP_LOG_POS);
+    } else {
+        colormap_kernel(data, n, pixels, lut, scale, bias, gray, COLORMAP_LOG_NEG);
     }
 }
 
@@ -2375,10 +5207,10 @@ void draw_colorbar(double vmin, double vmax, int cmap_type, const char *varname)
     }
 
     /* Draw colorbar as solid rectangles within margins */
+    const uint32_t *lut = colormap_lut(cmap_type);
     for (int i = 0; i < height; i++) {
         double t = (double)(height - 1 - i) / (height - 1);
-        RGB color = get_colormap_rgb(t, cmap_type);
-        unsigned long pixel = (color.r << 16) | (color.g << 8) | color.b;
+        unsigned long pixel = lut[(int)(t * (COLORMAP_LUT_SIZE - 1) + 0.5)];
 
         XSetForeground(display, colorbar_gc, pixel);
         int y = top_margin + (i * (canvas_height - top_margin - bottom_margin)) / height;
@@ -2750,6 +5582,7 @@ void init_gui(PlotfileData *pf, int argc, char **argv) {
     XSetForeground(display, gc, BlackPixel(display, screen));
     XSetFillStyle(display, gc, FillSolid);
     XSetFunction(display, gc, GXcopy);
+    XSetGraphicsExposures(display, gc, False);  /* Canvas repaints copy from the pixmap */
     
     /* Get colorbar window */
     colorbar = XtWindow(colorbar_widget);
@@ -2768,6 +5601,8 @@ void init_gui(PlotfileData *pf, int argc, char **argv) {
     pixel_data = (unsigned long *)malloc(pixel_data_size * sizeof(unsigned long));
     pixmap = XCreatePixmap(display, canvas, canvas_width, canvas_height, 
                           DefaultDepth(display, screen));
+    XSetForeground(display, gc, WhitePixel(display, screen));
+    XFillRectangle(display, pixmap, gc, 0, 0, canvas_width, canvas_height);
     colorbar_pixmap = XCreatePixmap(display, colorbar, 100, 256,
                                    DefaultDepth(display, screen));
     
@@ -2834,6 +5669,8 @@ void update_info_label(PlotfileData *pf) {
 void var_button_callback(Widget w, XtPointer client_data, XtPointer call_data) {
     int var = (int)(long)client_data;
     if (global_pf && var < global_pf->n_vars) {
+        /* Read-ahead of the old variable is useless now */
+        prefetch_cancel();
         global_pf->current_var = var;
         read_variable_data(global_pf, var);
 
@@ -2846,6 +5683,7 @@ void var_button_callback(Widget w, XtPointer client_data, XtPointer call_data) {
         update_info_label(global_pf);
         render_slice(global_pf);
         update_distribution_histogram(-1);  /* Auto-update distribution popup */
+        prefetch_neighbour_timesteps(global_pf, 0);
     }
 }
 
@@ -3665,11 +6503,41 @@ void colorbar_apply_callback(Widget w, XtPointer client_data, XtPointer call_dat
 void colorbar_auto_callback(Widget w, XtPointer client_data, XtPointer call_data) {
     ColorbarDialogData *data = (ColorbarDialogData *)client_data;
 
-    use_custom_range = 0;
+    use_custom_range = 0;
+
+    /* Re-render with auto range */
+    if (global_pf) {
+        render_slice(global_pf);
+    }
+
+    if (data) {
+        /* Close the dialog */
+        XtPopdown(data->dialog_shell);
+        XtDestroyWidget(data->dialog_shell);
+        free(data);
+        dialog_active = 0;
+        active_text_widget = NULL;
+        active_colorbar_dialog = NULL;
+    }
+}
+
+/* Lock the range to the variable's min/max over the current level (or that
+ * level in every timestep) from the Cell_H metadata, without reading data */
+static void colorbar_set_metadata_range(ColorbarDialogData *data, int all_timesteps) {
+    double vmin, vmax;
 
-    /* Re-render with auto range */
-    if (global_pf) {
+    if (global_pf &&
+        variable_range_from_cell_h(global_pf, global_pf->current_var, all_timesteps,
+                                   &vmin, &vmax) == 0) {
+        if (vmax <= vmin) vmax = vmin + 1.0;
+        custom_vmin = vmin;
+        custom_vmax = vmax;
+        use_custom_range = 1;
+        printf("Colorbar range from Cell_H%s: [%.6e, %.6e]\n",
+               all_timesteps ? " (all timesteps)" : "", vmin, vmax);
         render_slice(global_pf);
+    } else {
+        fprintf(stderr, "Warning: Cell_H has no min/max for this variable\n");
     }
 
     if (data) {
@@ -3683,6 +6551,16 @@ void colorbar_auto_callback(Widget w, XtPointer client_data, XtPointer call_data
     }
 }
 
+/* Level range callback - min/max of the whole level */
+void colorbar_level_range_callback(Widget w, XtPointer client_data, XtPointer call_data) {
+    colorbar_set_metadata_range((ColorbarDialogData *)client_data, 0);
+}
+
+/* All-times range callback - one range for every timestep */
+void colorbar_all_times_range_callback(Widget w, XtPointer client_data, XtPointer call_data) {
+    colorbar_set_metadata_range((ColorbarDialogData *)client_data, 1);
+}
+
 /* Close colorbar dialog callback */
 void colorbar_close_callback(Widget w, XtPointer client_data, XtPointer call_data) {
     ColorbarDialogData *data = (ColorbarDialogData *)client_data;
@@ -3851,6 +6729,20 @@ void colorbar_button_callback(Widget w, XtPointer client_data, XtPointer call_da
         n = 0;
         XtSetArg(args[n], XtNfromVert, cmap_label); n++;
         XtSetArg(args[n], XtNfromHoriz, auto_button); n++;
+        XtSetArg(args[n], XtNlabel, "Level"); n++;
+        button = XtCreateManagedWidget("levelRange", commandWidgetClass, form, args, n);
+        XtAddCallback(button, XtNcallback, colorbar_level_range_callback, (XtPointer)colorbar_data);
+
+        n = 0;
+        XtSetArg(args[n], XtNfromVert, cmap_label); n++;
+        XtSetArg(args[n], XtNfromHoriz, button); n++;
+        XtSetArg(args[n], XtNlabel, "All Times"); n++;
+        button = XtCreateManagedWidget("allTimesRange", commandWidgetClass, form, args, n);
+        XtAddCallback(button, XtNcallback, colorbar_all_times_range_callback, (XtPointer)colorbar_data);
+
+        n = 0;
+        XtSetArg(args[n], XtNfromVert, cmap_label); n++;
+        XtSetArg(args[n], XtNfromHoriz, button); n++;
         XtSetArg(args[n], XtNlabel, "Close"); n++;
         button = XtCreateManagedWidget("close", commandWidgetClass, form, args, n);
         XtAddCallback(button, XtNcallback, colorbar_close_callback, (XtPointer)colorbar_data);
@@ -3941,114 +6833,1212 @@ void colormap_button_callback(Widget w, XtPointer client_data, XtPointer call_da
         Widget prev_button = label;
         char cmap_label[32];
 
-        for (i = 0; i < 8; i++) {
-            n = 0;
-            XtSetArg(args[n], XtNfromVert, prev_button); n++;
-            snprintf(cmap_label, sizeof(cmap_label), "%d. %s", i + 1, cmap_names[i]);
-            XtSetArg(args[n], XtNlabel, cmap_label); n++;
-            XtSetArg(args[n], XtNwidth, 100); n++;
-            button = XtCreateManagedWidget(cmap_names[i], commandWidgetClass, form, args, n);
-            XtAddCallback(button, XtNcallback, cmap_select_callback, (XtPointer)(long)i);
-            prev_button = button;
-        }
+        for (i = 0; i < 8; i++) {
+            n = 0;
+            XtSetArg(args[n], XtNfromVert, prev_button); n++;
+            snprintf(cmap_label, sizeof(cmap_label), "%d. %s", i + 1, cmap_names[i]);
+            XtSetArg(args[n], XtNlabel, cmap_label); n++;
+            XtSetArg(args[n], XtNwidth, 100); n++;
+            button = XtCreateManagedWidget(cmap_names[i], commandWidgetClass, form, args, n);
+            XtAddCallback(button, XtNcallback, cmap_select_callback, (XtPointer)(long)i);
+            prev_button = button;
+        }
+
+        /* Close button */
+        n = 0;
+        XtSetArg(args[n], XtNfromVert, prev_button); n++;
+        XtSetArg(args[n], XtNlabel, "Close"); n++;
+        button = XtCreateManagedWidget("close", commandWidgetClass, form, args, n);
+        XtAddCallback(button, XtNcallback, cmap_dialog_close_callback, (XtPointer)dialog_shell);
+
+        XtRealizeWidget(dialog_shell);
+        XtPopup(dialog_shell, XtGrabNone);
+    }
+}
+
+/* Repaint a damaged canvas area from the backing pixmap. Only renders
+ * when no frame has been drawn yet; state changes call render_slice. */
+void canvas_repaint(int x, int y, int width, int height) {
+    if (!pixmap_valid) {
+        if (global_pf && global_pf->data) render_slice(global_pf);
+        return;
+    }
+    XCopyArea(display, pixmap, canvas, gc, x, y, width, height, x, y);
+}
+
+/* Canvas expose callback */
+void canvas_expose_callback(Widget w, XtPointer client_data, XtPointer call_data) {
+    canvas_repaint(0, 0, canvas_width, canvas_height);
+}
+
+/* Colorbar expose callback */
+void colorbar_expose_callback(Widget w, XtPointer client_data, XtPointer call_data) {
+    if (global_pf) {
+        draw_colorbar(current_vmin, current_vmax, global_pf->colormap,
+                      global_pf->variables[global_pf->current_var]);
+    }
+}
+
+static void draw_y_label_ccw(const char *label, int x, int y_center) {
+    if (!label || !label[0] || !font) return;
+
+    int len = (int)strlen(label);
+    int text_w = XTextWidth(font, label, len);
+    int text_h = font->ascent + font->descent;
+    if (text_w <= 0 || text_h <= 0) return;
+
+    Pixmap tmp = XCreatePixmap(display, canvas, text_w, text_h,
+                               DefaultDepth(display, screen));
+    if (!tmp) return;
+
+    GC tmp_gc = XCreateGC(display, tmp, 0, NULL);
+    if (!tmp_gc) {
+        XFreePixmap(display, tmp);
+        return;
+    }
+
+    XSetForeground(display, tmp_gc, WhitePixel(display, screen));
+    XFillRectangle(display, tmp, tmp_gc, 0, 0, text_w, text_h);
+    XSetForeground(display, tmp_gc, BlackPixel(display, screen));
+    if (font) {
+        XSetFont(display, tmp_gc, font->fid);
+    }
+    XDrawString(display, tmp, tmp_gc, 0, font->ascent, label, len);
+
+    XImage *src = XGetImage(display, tmp, 0, 0, text_w, text_h, AllPlanes, ZPixmap);
+    if (!src) {
+        XFreeGC(display, tmp_gc);
+        XFreePixmap(display, tmp);
+        return;
+    }
+
+    int dest_w = text_h;
+    int dest_h = text_w;
+    XImage *rot = XCreateImage(display, DefaultVisual(display, screen),
+                               DefaultDepth(display, screen), ZPixmap, 0, NULL,
+                               dest_w, dest_h, 32, 0);
+    if (!rot) {
+        XDestroyImage(src);
+        XFreeGC(display, tmp_gc);
+        XFreePixmap(display, tmp);
+        return;
+    }
+    rot->data = (char *)malloc((size_t)rot->bytes_per_line * (size_t)dest_h);
+    if (!rot->data) {
+        XDestroyImage(rot);
+        XDestroyImage(src);
+        XFreeGC(display, tmp_gc);
+        XFreePixmap(display, tmp);
+        return;
+    }
+
+    for (int y = 0; y < text_h; y++) {
+        for (int xx = 0; xx < text_w; xx++) {
+            unsigned long pixel = XGetPixel(src, xx, y);
+            int rx = y;
+            int ry = dest_h - 1 - xx;
+            XPutPixel(rot, rx, ry, pixel);
+        }
+    }
+
+    int draw_y = y_center - dest_h / 2;
+    XPutImage(display, pixmap, text_gc, rot, 0, 0, x, draw_y, dest_w, dest_h);
+
+    XDestroyImage(rot);
+    XDestroyImage(src);
+    XFreeGC(display, tmp_gc);
+    XFreePixmap(display, tmp);
+}
+
+/* ========== Shared-Memory Images ========== */
+
+/* Client-side images for the canvas and the contour plots. On a local
+ * display with the MIT-SHM extension the pixels live in a shared memory
+ * segment the server reads in place; remote displays (e.g. ssh -X) and
+ * servers without the extension get plain XPutImage. PLTVIEW_NO_SHM=1
+ * forces the plain path. */
+typedef struct {
+    Display *dpy;
+    XImage *image;
+    XShmSegmentInfo shm;
+    int use_shm;
+} SharedImage;
+
+static int shm_unavailable;     /* Set once MIT-SHM is known not to work */
+static int shm_attach_failed;
+
+static int shm_error_handler(Display *dpy, XErrorEvent *event) {
+    (void)dpy;
+    (void)event;
+    shm_attach_failed = 1;
+    return 0;
+}
+
+/* Local connections are ":N", "unix:N" or a socket path (XQuartz) */
+static int display_is_local(Display *dpy) {
+    const char *name = DisplayString(dpy);
+    if (!name) return 0;
+    return name[0] == ':' || name[0] == '/' || strncmp(name, "unix:", 5) == 0;
+}
+
+static void shared_image_destroy(SharedImage *si) {
+    if (!si->image) return;
+    if (si->use_shm) {
+        XShmDetach(si->dpy, &si->shm);
+        XSync(si->dpy, False);
+        si->image->data = NULL;
+        XDestroyImage(si->image);
+        shmdt(si->shm.shmaddr);
+    } else {
+        XDestroyImage(si->image);  /* Frees the malloc'd pixels too */
+    }
+    si->image = NULL;
+    si->use_shm = 0;
+}
+
+/* Try to back a w x h image with a shared segment; returns NULL on failure */
+static XImage *shared_image_create_shm(SharedImage *si, Display *dpy, int w, int h) {
+    int scr = DefaultScreen(dpy);
+    XImage *img = XShmCreateImage(dpy, DefaultVisual(dpy, scr), DefaultDepth(dpy, scr),
+                                  ZPixmap, NULL, &si->shm, w, h);
+    if (!img) return NULL;
+
+    si->shm.shmid = shmget(IPC_PRIVATE, (size_t)img->bytes_per_line * img->height,
+                           IPC_CREAT | 0600);
+    if (si->shm.shmid < 0) {
+        XDestroyImage(img);
+        return NULL;
+    }
+    si->shm.shmaddr = img->data = (char *)shmat(si->shm.shmid, NULL, 0);
+    if (si->shm.shmaddr == (char *)-1) {
+        shmctl(si->shm.shmid, IPC_RMID, NULL);
+        img->data = NULL;
+        XDestroyImage(img);
+        return NULL;
+    }
+    si->shm.readOnly = False;
+
+    /* A server on another host fails the attach with BadAccess */
+    XSync(dpy, False);
+    shm_attach_failed = 0;
+    XErrorHandler old_handler = XSetErrorHandler(shm_error_handler);
+    XShmAttach(dpy, &si->shm);
+    XSync(dpy, False);
+    XSetErrorHandler(old_handler);
+
+    /* Marked for removal now; it goes away once both sides detach */
+    shmctl(si->shm.shmid, IPC_RMID, NULL);
+    if (shm_attach_failed) {
+        shmdt(si->shm.shmaddr);
+        img->data = NULL;
+        XDestroyImage(img);
+        return NULL;
+    }
+    return img;
+}
+
+/* Make si hold an image of at least w x h pixels for dpy's default visual */
+static int shared_image_reserve(SharedImage *si, Display *dpy, int w, int h) {
+    if (si->image && si->dpy == dpy && si->image->width >= w && si->image->height >= h) {
+        return 0;
+    }
+    shared_image_destroy(si);
+    si->dpy = dpy;
+
+    if (!shm_unavailable) {
+        const char *env = getenv("PLTVIEW_NO_SHM");
+        if ((env && atoi(env) != 0) || !display_is_local(dpy) || !XShmQueryExtension(dpy)) {
+            shm_unavailable = 1;
+        } else {
+            si->image = shared_image_create_shm(si, dpy, w, h);
+            if (si->image) {
+                si->use_shm = 1;
+                return 0;
+            }
+            fprintf(stderr, "Warning: MIT-SHM unavailable, using XPutImage\n");
+            shm_unavailable = 1;
+        }
+    }
+
+    int scr = DefaultScreen(dpy);
+    si->image = XCreateImage(dpy, DefaultVisual(dpy, scr), DefaultDepth(dpy, scr),
+                             ZPixmap, 0, NULL, w, h, 32, 0);
+    if (!si->image) return -1;
+    si->image->data = (char *)malloc((size_t)si->image->bytes_per_line * h);
+    if (!si->image->data) {
+        XDestroyImage(si->image);
+        si->image = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/* Copy the top-left w x h pixels of si to (x, y) on a drawable */
+static void shared_image_put(SharedImage *si, Drawable d, GC image_gc, int x, int y, int w, int h) {
+    if (!si->image) return;
+    if (si->use_shm) {
+        XShmPutImage(si->dpy, d, image_gc, si->image, 0, 0, x, y, w, h, False);
+        /* The server reads the segment asynchronously; wait before it is reused */
+        XSync(si->dpy, False);
+    } else {
+        XPutImage(si->dpy, d, image_gc, si->image, 0, 0, x, y, w, h);
+    }
+}
+
+/* ========== Canvas Frame Image ========== */
+
+/* The data area of the canvas is composed client-side in frame_image and
+ * sent in one request, instead of one XSetForeground/XFillRectangle pair
+ * per cell. frame_* coordinates are canvas coordinates; everything outside
+ * the frame rectangle is clipped. */
+static SharedImage frame_image;
+static int frame_x, frame_y, frame_w, frame_h;
+static int frame_direct;    /* 32 bpp in host byte order: store pixels directly */
+
+/* Pan cache: the data layer (frame, box outlines, quiver and map overlays)
+ * is drawn into this pixmap rather than the canvas pixmap. When zoomed it
+ * covers the visible area plus half a view on each side, so drag-panning
+ * only copies a different part of it. Layer drawing uses canvas
+ * coordinates minus (layer_dx, layer_dy). */
+static Pixmap pan_cache;
+static int pan_cache_pw, pan_cache_ph;      /* Pixmap size */
+static int pan_cache_valid;
+static double pan_cache_zoom;
+static int pan_cache_x, pan_cache_y;        /* Layer origin in the zoomed image */
+static int pan_cache_w, pan_cache_h;
+static int layer_dx, layer_dy;              /* Canvas position of the layer origin */
+
+/* AMR box outlines, drawn in red over the frame once it is on the canvas */
+static XRectangle *frame_box_rects;
+static int n_frame_box_rects, cap_frame_box_rects;
+static XSegment *frame_box_segs;
+static int n_frame_box_segs, cap_frame_box_segs;
+
+/* Start a frame covering canvas rectangle (x, y, w, h), filled with white */
+static int frame_begin(int x, int y, int w, int h) {
+    int row, col;
+    int one = 1;
+
+    frame_w = frame_h = 0;
+    if (w <= 0 || h <= 0) return -1;
+    if (shared_image_reserve(&frame_image, display, w, h) < 0) return -1;
+    ximage = frame_image.image;
+    frame_direct = ximage->bits_per_pixel == 32 &&
+                   ximage->byte_order == (*(char *)&one ? LSBFirst : MSBFirst);
+    frame_x = x;
+    frame_y = y;
+    frame_w = w;
+    frame_h = h;
+
+    unsigned long white = WhitePixel(display, screen);
+    for (row = 0; row < h; row++) {
+        if (frame_direct) {
+            uint32_t *dst = (uint32_t *)(ximage->data + (size_t)row * ximage->bytes_per_line);
+            for (col = 0; col < w; col++) dst[col] = (uint32_t)white;
+        } else {
+            for (col = 0; col < w; col++) XPutPixel(ximage, col, row, white);
+        }
+    }
+    return 0;
+}
+
+static inline void frame_store(int col, int row, unsigned long pixel) {
+    if (frame_direct) {
+        ((uint32_t *)(ximage->data + (size_t)row * ximage->bytes_per_line))[col] = (uint32_t)pixel;
+    } else {
+        XPutPixel(ximage, col, row, pixel);
+    }
+}
+
+/* Fill canvas rectangle (x, y, w, h) of the frame with one pixel value */
+static void frame_fill_rect(int x, int y, int w, int h, unsigned long pixel) {
+    int x0 = x - frame_x, y0 = y - frame_y;
+    int x1 = x0 + w, y1 = y0 + h;
+    int row, col;
+
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > frame_w) x1 = frame_w;
+    if (y1 > frame_h) y1 = frame_h;
+    for (row = y0; row < y1; row++) {
+        for (col = x0; col < x1; col++) frame_store(col, row, pixel);
+    }
+}
+
+/* Map frame pixels along one axis to the cells covering them: slot c spans
+ * [base + (int)(c * size), base + (int)((c + 1) * size)), at least one
+ * pixel. flip stores cell n_cells - 1 - c in slot c (the y axis). Where
+ * slots overlap, the cell with the higher index wins, as it did when the
+ * cells were drawn one rectangle at a time. */
+static void frame_cell_lookup(int *lookup, int n_px, int frame_lo, int n_cells,
+                              int base, double size, int flip) {
+    int c, k, p;
+
+    for (p = 0; p < n_px; p++) lookup[p] = -1;
+    int first = (int)((frame_lo - base) / size) - 1;
+    int last = (int)((frame_lo + n_px - base) / size) + 1;
+    if (first < 0) first = 0;
+    if (last > n_cells - 1) last = n_cells - 1;
+    for (k = first; k <= last; k++) {
+        c = flip ? first + last - k : k;
+        int p0 = base + (int)(c * size) - frame_lo;
+        int p1 = base + (int)((c + 1) * size) - frame_lo;
+        if (p1 <= p0) p1 = p0 + 1;
+        if (p0 < 0) p0 = 0;
+        if (p1 > n_px) p1 = n_px;
+        for (p = p0; p < p1; p++) lookup[p] = flip ? n_cells - 1 - c : c;
+    }
+}
+
+/* Scale a width x height cell image (row 0 at the bottom) into the frame
+ * with nearest-neighbour sampling; cell (i, j) covers the same pixels as a
+ * rectangle at base + (i * cell_w, (height - 1 - j) * cell_h). Cells with
+ * mask[j * width + i] == 0 are left untouched (mask may be NULL). */
+static void frame_blit_cells(const unsigned long *pixels, const unsigned char *mask,
+                             int width, int height, int base_x, int base_y,
+                             double cell_w, double cell_h) {
+    int row, col;
+
+    if (frame_w <= 0 || width <= 0 || height <= 0 || cell_w <= 0 || cell_h <= 0) return;
+    int *col_cell = (int *)malloc(frame_w * sizeof(int));
+    int *row_cell = (int *)malloc(frame_h * sizeof(int));
+    if (!col_cell || !row_cell) {
+        free(col_cell);
+        free(row_cell);
+        return;
+    }
+    frame_cell_lookup(col_cell, frame_w, frame_x, width, base_x, cell_w, 0);
+    frame_cell_lookup(row_cell, frame_h, frame_y, height, base_y, cell_h, 1);
+
+    for (row = 0; row < frame_h; row++) {
+        int j = row_cell[row];
+        if (j < 0) continue;
+        const unsigned long *src = pixels + (size_t)j * width;
+        const unsigned char *src_mask = mask ? mask + (size_t)j * width : NULL;
+        for (col = 0; col < frame_w; col++) {
+            int i = col_cell[col];
+            if (i < 0 || (src_mask && !src_mask[i])) continue;
+            frame_store(col, row, src[i]);
+        }
+    }
+    free(col_cell);
+    free(row_cell);
+}
+
+/* Queue a box outline rectangle (thin line) */
+static void frame_add_box_rect(int x, int y, int w, int h) {
+    if (w < 0 || h < 0) return;
+    if (n_frame_box_rects == cap_frame_box_rects) {
+        int new_cap = cap_frame_box_rects > 0 ? cap_frame_box_rects * 2 : 256;
+        XRectangle *tmp = (XRectangle *)realloc(frame_box_rects, new_cap * sizeof(XRectangle));
+        if (!tmp) return;
+        frame_box_rects = tmp;
+        cap_frame_box_rects = new_cap;
+    }
+    XRectangle *r = &frame_box_rects[n_frame_box_rects++];
+    r->x = x;
+    r->y = y;
+    r->width = w;
+    r->height = h;
+}
+
+/* Queue a box outline segment (2 px line, for curved map-mode outlines) */
+static void frame_add_box_segment(int x0, int y0, int x1, int y1) {
+    if (n_frame_box_segs == cap_frame_box_segs) {
+        int new_cap = cap_frame_box_segs > 0 ? cap_frame_box_segs * 2 : 1024;
+        XSegment *tmp = (XSegment *)realloc(frame_box_segs, new_cap * sizeof(XSegment));
+        if (!tmp) return;
+        frame_box_segs = tmp;
+        cap_frame_box_segs = new_cap;
+    }
+    XSegment *seg = &frame_box_segs[n_frame_box_segs++];
+    seg->x1 = x0;
+    seg->y1 = y0;
+    seg->x2 = x1;
+    seg->y2 = y1;
+}
+
+/* Send the composed frame to the pan cache, then the queued box outlines */
+static void frame_end(void) {
+    int k;
+
+    if (frame_w > 0) {
+        shared_image_put(&frame_image, pan_cache, gc, frame_x - layer_dx, frame_y - layer_dy,
+                         frame_w, frame_h);
+    }
+    frame_w = frame_h = 0;
+
+    if (n_frame_box_rects > 0) {
+        for (k = 0; k < n_frame_box_rects; k++) {
+            frame_box_rects[k].x -= layer_dx;
+            frame_box_rects[k].y -= layer_dy;
+        }
+        XSetForeground(display, gc, 0xFF0000);  /* Red */
+        XDrawRectangles(display, pan_cache, gc, frame_box_rects, n_frame_box_rects);
+    }
+    if (n_frame_box_segs > 0) {
+        for (k = 0; k < n_frame_box_segs; k++) {
+            frame_box_segs[k].x1 -= layer_dx;
+            frame_box_segs[k].y1 -= layer_dy;
+            frame_box_segs[k].x2 -= layer_dx;
+            frame_box_segs[k].y2 -= layer_dy;
+        }
+        XSetForeground(display, gc, 0xFF0000);  /* Red */
+        XSetLineAttributes(display, gc, 2, LineSolid, CapButt, JoinMiter);
+        XDrawSegments(display, pan_cache, gc, frame_box_segs, n_frame_box_segs);
+        XSetLineAttributes(display, gc, 0, LineSolid, CapButt, JoinMiter);
+    }
+    n_frame_box_rects = n_frame_box_segs = 0;
+}
+
+/* Start the data layer for a zoomed image of zoomed_w x zoomed_h placed at
+ * canvas (base_x, base_y): pick the cached region around the visible area
+ * and begin a frame over it */
+static int layer_begin(int zoomed_w, int zoomed_h, int base_x, int base_y) {
+    int x0 = vis_area_x, y0 = vis_area_y;
+    int x1 = vis_area_x + vis_area_w, y1 = vis_area_y + vis_area_h;
+
+    if (zoom_level > 1.0) {
+        x0 -= vis_area_w / 2;
+        x1 += vis_area_w / 2;
+        y0 -= vis_area_h / 2;
+        y1 += vis_area_h / 2;
+        if (x0 < base_x) x0 = base_x;
+        if (y0 < base_y) y0 = base_y;
+        if (x1 > base_x + zoomed_w) x1 = base_x + zoomed_w;
+        if (y1 > base_y + zoomed_h) y1 = base_y + zoomed_h;
+    }
+
+    pan_cache_valid = 0;
+    pan_cache_w = pan_cache_h = 0;
+    if (x1 <= x0 || y1 <= y0) return -1;
+    if (!pan_cache || x1 - x0 > pan_cache_pw || y1 - y0 > pan_cache_ph) {
+        if (pan_cache) XFreePixmap(display, pan_cache);
+        pan_cache_pw = x1 - x0 > 2 * canvas_width ? x1 - x0 : 2 * canvas_width;
+        pan_cache_ph = y1 - y0 > 2 * canvas_height ? y1 - y0 : 2 * canvas_height;
+        pan_cache = XCreatePixmap(display, canvas, pan_cache_pw, pan_cache_ph,
+                                  DefaultDepth(display, screen));
+    }
+
+    layer_dx = x0;
+    layer_dy = y0;
+    pan_cache_x = x0 - base_x;
+    pan_cache_y = y0 - base_y;
+    pan_cache_w = x1 - x0;
+    pan_cache_h = y1 - y0;
+    pan_cache_zoom = zoom_level;
+    return frame_begin(x0, y0, x1 - x0, y1 - y0);
+}
+
+/* Copy the visible part of the data layer, at the current zoom scroll,
+ * into the canvas pixmap */
+static void layer_show(void) {
+    if (!pan_cache || pan_cache_w <= 0) return;
+    XCopyArea(display, pan_cache, pixmap, gc, zoom_scroll_x - pan_cache_x,
+              zoom_scroll_y - pan_cache_y, vis_area_w, vis_area_h, vis_area_x, vis_area_y);
+}
+
+/* ========== Slice LOD Pyramid ========== */
+
+/* A slice with more cells than the zoomed image has pixels is drawn from a
+ * coarser level of a 2x2 pyramid instead of coloring every cell. Each
+ * level keeps the mean, min and max of its children, and a coarse cell
+ * shows whichever extreme lies further from its mean, so narrow spikes
+ * survive down to the displayed level. The pyramid belongs to one slice
+ * and is reused across zoom, pan and colormap changes. */
+#define SLICE_LOD_MAX_LEVELS 16
+#define SLICE_LOD_ROWS_PER_ITEM 32
+
+typedef struct {
+    int width, height;
+    double *mean, *min, *max;
+    unsigned char *mask;        /* Any child inside a box; NULL = all cells */
+} SliceLodLevel;
+
+static struct {
+    int n_levels;               /* Levels in use; level 0 is the slice itself */
+    SliceLodLevel levels[SLICE_LOD_MAX_LEVELS];
+    /* Slice the pyramid was built from. A reread volume can come back at the
+     * same address, so the level's Cell_H mtime is part of the key. */
+    const double *data;
+    time_t stamp;
+    int var, level, axis, idx, timestep, width, height, masked;
+} slice_lod;
+
+typedef struct {
+    const SliceLodLevel *fine;
+    SliceLodLevel *coarse;
+} SliceLodReduce;
+
+/* Reduce one band of coarse rows from the 2x2 children below it */
+static void slice_lod_reduce_rows(void *ctx, int item) {
+    const SliceLodReduce *r = (const SliceLodReduce *)ctx;
+    const SliceLodLevel *f = r->fine;
+    SliceLodLevel *c = r->coarse;
+    int j0 = item * SLICE_LOD_ROWS_PER_ITEM;
+    int j1 = j0 + SLICE_LOD_ROWS_PER_ITEM;
+    int i, j, di, dj;
+
+    if (j1 > c->height) j1 = c->height;
+    for (j = j0; j < j1; j++) {
+        for (i = 0; i < c->width; i++) {
+            double sum = 0.0, lo = 0.0, hi = 0.0;
+            int n = 0;
+            for (dj = 0; dj < 2 && 2 * j + dj < f->height; dj++) {
+                for (di = 0; di < 2 && 2 * i + di < f->width; di++) {
+                    size_t k = (size_t)(2 * j + dj) * f->width + 2 * i + di;
+                    if (f->mask && !f->mask[k]) continue;
+                    if (n == 0 || f->min[k] < lo) lo = f->min[k];
+                    if (n == 0 || f->max[k] > hi) hi = f->max[k];
+                    sum += f->mean[k];
+                    n++;
+                }
+            }
+            size_t k = (size_t)j * c->width + i;
+            c->mean[k] = n > 0 ? sum / n : 0.0;
+            c->min[k] = lo;
+            c->max[k] = hi;
+            if (c->mask) c->mask[k] = n > 0;
+        }
+    }
+}
+
+static void slice_lod_free(void) {
+    int l;
+    for (l = 1; l < slice_lod.n_levels; l++) {
+        free(slice_lod.levels[l].mean);
+        free(slice_lod.levels[l].min);
+        free(slice_lod.levels[l].max);
+        free(slice_lod.levels[l].mask);
+    }
+    memset(&slice_lod, 0, sizeof(slice_lod));
+}
+
+/* Point level 0 at the freshly extracted slice and (re)build the coarse
+ * levels unless they already belong to this slice. Coarse levels stop at
+ * the first one that fits on the canvas; the zoomed image is never
+ * smaller than that. */
+static void slice_lod_update(PlotfileData *pf, const double *slice, const unsigned char *mask,
+                             int width, int height) {
+    time_t stamp = level_cell_h_stamp(pf->plotfile_dir, pf->current_level);
+    int l;
+
+    if (slice_lod.n_levels > 0 && slice_lod.data == pf->data && slice_lod.stamp == stamp &&
+        slice_lod.var == pf->current_var && slice_lod.level == pf->current_level &&
+        slice_lod.axis == pf->slice_axis && slice_lod.idx == pf->slice_idx &&
+        slice_lod.timestep == current_timestep && slice_lod.width == width &&
+        slice_lod.height == height && slice_lod.masked == (mask != NULL)) {
+        SliceLodLevel *base = &slice_lod.levels[0];
+        base->mean = base->min = base->max = (double *)slice;
+        base->mask = (unsigned char *)mask;
+        return;
+    }
+
+    slice_lod_free();
+    slice_lod.data = pf->data;
+    slice_lod.stamp = stamp;
+    slice_lod.var = pf->current_var;
+    slice_lod.level = pf->current_level;
+    slice_lod.axis = pf->slice_axis;
+    slice_lod.idx = pf->slice_idx;
+    slice_lod.timestep = current_timestep;
+    slice_lod.width = width;
+    slice_lod.height = height;
+    slice_lod.masked = mask != NULL;
+
+    SliceLodLevel *base = &slice_lod.levels[0];
+    base->width = width;
+    base->height = height;
+    base->mean = base->min = base->max = (double *)slice;
+    base->mask = (unsigned char *)mask;
+    slice_lod.n_levels = 1;
+
+    for (l = 1; l < SLICE_LOD_MAX_LEVELS; l++) {
+        SliceLodLevel *fine = &slice_lod.levels[l - 1];
+        SliceLodLevel *coarse = &slice_lod.levels[l];
+        if (fine->width <= canvas_width && fine->height <= canvas_height) break;
+
+        coarse->width = (fine->width + 1) / 2;
+        coarse->height = (fine->height + 1) / 2;
+        size_t n = (size_t)coarse->width * coarse->height;
+        coarse->mean = (double *)malloc(n * sizeof(double));
+        coarse->min = (double *)malloc(n * sizeof(double));
+        coarse->max = (double *)malloc(n * sizeof(double));
+        coarse->mask = mask ? (unsigned char *)malloc(n) : NULL;
+        if (!coarse->mean || !coarse->min || !coarse->max || (mask && !coarse->mask)) {
+            free(coarse->mean);
+            free(coarse->min);
+            free(coarse->max);
+            free(coarse->mask);
+            memset(coarse, 0, sizeof(*coarse));
+            break;
+        }
+
+        SliceLodReduce reduce = { fine, coarse };
+        pool_run(slice_lod_reduce_rows, &reduce,
+                 (coarse->height + SLICE_LOD_ROWS_PER_ITEM - 1) / SLICE_LOD_ROWS_PER_ITEM);
+        slice_lod.n_levels = l + 1;
+    }
+}
+
+/* Coarsest level that still has at least one cell per pixel of a
+ * zoomed_w x zoomed_h image */
+static int slice_lod_pick(int zoomed_w, int zoomed_h) {
+    int l = 0;
+    while (l + 1 < slice_lod.n_levels &&
+           slice_lod.levels[l + 1].width >= zoomed_w &&
+           slice_lod.levels[l + 1].height >= zoomed_h) {
+        l++;
+    }
+    return l;
+}
+
+/* First and last cells of an n_cells row of size-pixel cells starting at
+ * base that can touch frame pixels [frame_lo, frame_lo + n_px) */
+static void slice_lod_window(int frame_lo, int n_px, int n_cells, int base, double size,
+                             int *first, int *last) {
+    *first = (int)((frame_lo - base) / size) - 1;
+    *last = (int)((frame_lo + n_px - base) / size) + 1;
+    if (*first < 0) *first = 0;
+    if (*last > n_cells - 1) *last = n_cells - 1;
+}
+
+/* Color the base slice from the matching pyramid level and blit it into
+ * the frame. The zoomed image is zoomed_w x zoomed_h at (base_x, base_y);
+ * only cells that can reach the frame are colored. */
+static void slice_lod_blit(int zoomed_w, int zoomed_h, int base_x, int base_y,
+                           double vmin, double vmax, int cmap_type) {
+    const SliceLodLevel *base = &slice_lod.levels[0];
+    if (slice_lod.n_levels == 0 || frame_w <= 0) return;
+
+    int l = slice_lod_pick(zoomed_w, zoomed_h);
+    const SliceLodLevel *lev = &slice_lod.levels[l];
+    int scale = 1 << l;
+    double cell_w = (double)zoomed_w / base->width * scale;
+    double cell_h = (double)zoomed_h / base->height * scale;
+
+    /* Coarse rows are counted from the bottom, so when the height is not a
+     * multiple of the scale the top row overhangs the image */
+    int lev_base_y = base_y - (int)((double)(lev->height * scale - base->height) *
+                                    zoomed_h / base->height);
+
+    size_t needed = (size_t)lev->width * lev->height;
+    if (needed > pixel_data_size) return;
+
+    int i0, i1, r0, r1, j;
+    slice_lod_window(frame_x, frame_w, lev->width, base_x, cell_w, &i0, &i1);
+    slice_lod_window(frame_y, frame_h, lev->height, lev_base_y, cell_h, &r0, &r1);
+    if (i1 < i0 || r1 < r0) return;
+
+    double *row_values = l > 0 ? (double *)malloc((size_t)(i1 - i0 + 1) * sizeof(double)) : NULL;
+    if (l > 0 && !row_values) return;
+    for (j = lev->height - 1 - r1; j <= lev->height - 1 - r0; j++) {
+        size_t k = (size_t)j * lev->width + i0;
+        const double *values = lev->mean + k;
+        if (l > 0) {
+            int i;
+            for (i = 0; i <= i1 - i0; i++) {
+                double mean = lev->mean[k + i], lo = lev->min[k + i], hi = lev->max[k + i];
+                row_values[i] = hi - mean > mean - lo ? hi : lo;
+            }
+            values = row_values;
+        }
+        apply_colormap((double *)values, i1 - i0 + 1, 1, pixel_data + k, vmin, vmax, cmap_type);
+    }
+    free(row_values);
+
+    frame_blit_cells(pixel_data, lev->mask, lev->width, lev->height, base_x, lev_base_y,
+                     cell_w, cell_h);
+}
+
+/* ========== AMR Overlay Compositing ========== */
+
+/* Overlay levels are composited in one pass: every frame pixel takes the
+ * finest level whose boxes on the slice plane cover it, reads that one
+ * cell straight from the level volume and is colored once. No level slice
+ * is extracted and coarse cells under finer boxes are never colored. */
+#define COMPOSITE_ROWS_PER_ITEM 16
+
+/* One AMR level as seen on the current slice plane */
+typedef struct {
+    const double *data;         /* Level volume */
+    size_t offset;              /* Index of plane cell (0, 0) */
+    size_t stride_i, stride_j;  /* Index steps along the plane's x and y */
+    int *col_cell, *row_cell;   /* Frame column/row -> plane cell, -1 outside */
+    int n_boxes;                /* Boxes on the plane that reach the frame */
+    int *box_x0, *box_x1;       /* Frame column span of each box, inclusive */
+    int *box_j0, *box_j1;       /* Plane row range of each box, inclusive */
+} CompositeLevel;
+
+/* Index layout of plane slice_idx along axis within a level volume */
+static void level_plane_layout(const LevelData *ld, int axis, int slice_idx, size_t *offset,
+                               size_t *stride_i, size_t *stride_j) {
+    size_t nx = ld->grid_dims[0], ny = ld->grid_dims[1];
+
+    if (axis == 2) {
+        *offset = (size_t)slice_idx * ny * nx;
+        *stride_i = 1;
+        *stride_j = nx;
+    } else if (axis == 1) {
+        *offset = (size_t)slice_idx * nx;
+        *stride_i = 1;
+        *stride_j = ny * nx;
+    } else {
+        *offset = (size_t)slice_idx;
+        *stride_i = nx;
+        *stride_j = ny * nx;
+    }
+}
+
+/* Plane cell range [i0, i1] x [j0, j1] of a box, clipped to the level;
+ * returns 0 when nothing is left */
+static int box_plane_cells(const Box *box, const LevelData *ld, int axis, int lwidth, int lheight,
+                           int *i0, int *i1, int *j0, int *j1) {
+    int dim_x, dim_y;
+    if (axis == 2) { dim_x = 0; dim_y = 1; }
+    else if (axis == 1) { dim_x = 0; dim_y = 2; }
+    else { dim_x = 1; dim_y = 2; }
+
+    *i0 = box->lo[dim_x] - ld->level_lo[dim_x];
+    *i1 = box->hi[dim_x] - ld->level_lo[dim_x];
+    *j0 = box->lo[dim_y] - ld->level_lo[dim_y];
+    *j1 = box->hi[dim_y] - ld->level_lo[dim_y];
+    if (*i0 < 0) *i0 = 0;
+    if (*j0 < 0) *j0 = 0;
+    if (*i1 >= lwidth) *i1 = lwidth - 1;
+    if (*j1 >= lheight) *j1 = lheight - 1;
+    return *i1 >= *i0 && *j1 >= *j0;
+}
+
+/* Min/max of a level's cells inside boxes on plane slice_idx, read in place */
+static void level_plane_minmax(const LevelData *ld, int axis, int slice_idx, int lwidth, int lheight,
+                               double *vmin, double *vmax) {
+    int *hits = (int *)malloc((ld->n_boxes > 0 ? ld->n_boxes : 1) * sizeof(int));
+    size_t offset, si, sj;
+    int h, i, j, i0, i1, j0, j1;
+
+    if (!hits) return;
+    level_plane_layout(ld, axis, slice_idx, &offset, &si, &sj);
+    int n_hits = boxes_on_plane(ld->boxes, ld->n_boxes, &ld->box_index, axis,
+                                slice_idx + ld->level_lo[axis], hits);
+    for (h = 0; h < n_hits; h++) {
+        if (!box_plane_cells(&ld->boxes[hits[h]], ld, axis, lwidth, lheight, &i0, &i1, &j0, &j1)) {
+            continue;
+        }
+        for (j = j0; j <= j1; j++) {
+            const double *row = ld->data + offset + j * sj;
+            for (i = i0; i <= i1; i++) {
+                double v = row[i * si];
+                if (v < *vmin) *vmin = v;
+                if (v > *vmax) *vmax = v;
+            }
+        }
+    }
+    free(hits);
+}
+
+static void composite_level_free(CompositeLevel *cl) {
+    free(cl->col_cell);
+    free(cl->row_cell);
+    free(cl->box_x0);
+    free(cl->box_x1);
+    free(cl->box_j0);
+    free(cl->box_j1);
+    memset(cl, 0, sizeof(*cl));
+}
+
+/* Frame column span [*p0, *p1] of plane cells [c0, c1] given the column
+ * lookup; returns 0 when none of them reaches the frame */
+static int composite_column_span(const int *col_cell, int n_px, int c0, int c1, int *p0, int *p1) {
+    int lo = 0, hi = n_px;
+
+    /* col_cell is -1 outside one run of nondecreasing cells */
+    while (lo < n_px && col_cell[lo] < 0) lo++;
+    while (hi > lo && col_cell[hi - 1] < 0) hi--;
+    int a = lo, b = hi;
+    while (a < b) {                      /* First pixel with cell >= c0 */
+        int mid = a + (b - a) / 2;
+        if (col_cell[mid] < c0) a = mid + 1;
+        else b = mid;
+    }
+    *p0 = a;
+    a = lo;
+    b = hi;
+    while (a < b) {                      /* First pixel with cell > c1 */
+        int mid = a + (b - a) / 2;
+        if (col_cell[mid] <= c1) a = mid + 1;
+        else b = mid;
+    }
+    *p1 = a - 1;
+    return *p1 >= *p0;
+}
+
+/* Set up a level whose plane cells (lwidth x lheight, row 0 at the bottom)
+ * sit at frame canvas position (base_x, base_y) with the given cell size */
+static int composite_level_init(CompositeLevel *cl, const LevelData *ld, int axis, int slice_idx,
+                                int lwidth, int lheight, int base_x, int base_y,
+                                double cell_w, double cell_h) {
+    int h;
+
+    memset(cl, 0, sizeof(*cl));
+    if (frame_w <= 0 || lwidth <= 0 || lheight <= 0 || cell_w <= 0 || cell_h <= 0) return -1;
+    cl->data = ld->data;
+    level_plane_layout(ld, axis, slice_idx, &cl->offset, &cl->stride_i, &cl->stride_j);
+
+    int n = ld->n_boxes > 0 ? ld->n_boxes : 1;
+    int *hits = (int *)malloc(n * sizeof(int));
+    cl->col_cell = (int *)malloc(frame_w * sizeof(int));
+    cl->row_cell = (int *)malloc(frame_h * sizeof(int));
+    cl->box_x0 = (int *)malloc(n * sizeof(int));
+    cl->box_x1 = (int *)malloc(n * sizeof(int));
+    cl->box_j0 = (int *)malloc(n * sizeof(int));
+    cl->box_j1 = (int *)malloc(n * sizeof(int));
+    if (!hits || !cl->col_cell || !cl->row_cell || !cl->box_x0 || !cl->box_x1 ||
+        !cl->box_j0 || !cl->box_j1) {
+        free(hits);
+        composite_level_free(cl);
+        return -1;
+    }
+    frame_cell_lookup(cl->col_cell, frame_w, frame_x, lwidth, base_x, cell_w, 0);
+    frame_cell_lookup(cl->row_cell, frame_h, frame_y, lheight, base_y, cell_h, 1);
+
+    int n_hits = boxes_on_plane(ld->boxes, ld->n_boxes, &ld->box_index, axis,
+                                slice_idx + ld->level_lo[axis], hits);
+    for (h = 0; h < n_hits; h++) {
+        int i0, i1, j0, j1, p0, p1;
+        if (!box_plane_cells(&ld->boxes[hits[h]], ld, axis, lwidth, lheight, &i0, &i1, &j0, &j1)) {
+            continue;
+        }
+        if (!composite_column_span(cl->col_cell, frame_w, i0, i1, &p0, &p1)) continue;
+        cl->box_x0[cl->n_boxes] = p0;
+        cl->box_x1[cl->n_boxes] = p1;
+        cl->box_j0[cl->n_boxes] = j0;
+        cl->box_j1[cl->n_boxes] = j1;
+        cl->n_boxes++;
+    }
+    free(hits);
+    return 0;
+}
+
+typedef struct {
+    const CompositeLevel *levels;   /* Coarsest first */
+    int n_levels;
+    double vmin, vmax;
+    int cmap_type;
+} CompositeJob;
+
+static void composite_rows(void *ctx, int item) {
+    const CompositeJob *job = (const CompositeJob *)ctx;
+    int row0 = item * COMPOSITE_ROWS_PER_ITEM;
+    int row1 = row0 + COMPOSITE_ROWS_PER_ITEM;
+    int row, l, b, p;
+
+    if (row1 > frame_h) row1 = frame_h;
+    unsigned char *covered = (unsigned char *)malloc(frame_w);
+    int *pos = (int *)malloc(frame_w * sizeof(int));
+    double *values = (double *)malloc(frame_w * sizeof(double));
+    unsigned long *pixels = (unsigned long *)malloc(frame_w * sizeof(unsigned long));
+    if (!covered || !pos || !values || !pixels) goto done;
+
+    for (row = row0; row < row1; row++) {
+        int n = 0;
+        memset(covered, 0, frame_w);
+        for (l = job->n_levels - 1; l >= 0; l--) {   /* Finest level wins */
+            const CompositeLevel *cl = &job->levels[l];
+            int j = cl->row_cell[row];
+            if (j < 0) continue;
+            const double *plane_row = cl->data + cl->offset + j * cl->stride_j;
+            for (b = 0; b < cl->n_boxes; b++) {
+                if (j < cl->box_j0[b] || j > cl->box_j1[b]) continue;
+                for (p = cl->box_x0[b]; p <= cl->box_x1[b]; p++) {
+                    if (covered[p]) continue;
+                    covered[p] = 1;
+                    pos[n] = p;
+                    values[n++] = plane_row[cl->col_cell[p] * cl->stride_i];
+                }
+            }
+        }
+        if (n == 0) continue;
+        apply_colormap(values, n, 1, pixels, job->vmin, job->vmax, job->cmap_type);
+        for (p = 0; p < n; p++) frame_store(pos[p], row, pixels[p]);
+    }
+
+done:
+    free(covered);
+    free(pos);
+    free(values);
+    free(pixels);
+}
+
+/* Composite n overlay levels (coarsest first) into the frame */
+static void frame_composite_levels(const CompositeLevel *levels, int n_levels,
+                                   double vmin, double vmax, int cmap_type) {
+    if (frame_w <= 0 || n_levels <= 0) return;
+    colormap_lut(cmap_type);  /* Build the table before the workers share it */
+    CompositeJob job = { levels, n_levels, vmin, vmax, cmap_type };
+    pool_run(composite_rows, &job, (frame_h + COMPOSITE_ROWS_PER_ITEM - 1) / COMPOSITE_ROWS_PER_ITEM);
+}
+
+/* ========== Map Mode Rasterizer ========== */
+
+/* Map mode fills each cell as the quad spanned by the corners between its
+ * centre and its neighbours' centres (edge corners are extrapolated half a
+ * cell outwards), split into two triangles and scan-converted with the
+ * cell's color. Neighbouring quads share corners, so the curvilinear mesh
+ * is covered without gaps. Frame rows are split into bands rasterized on
+ * the worker pool; each band only visits mesh rows whose strip reaches it. */
+#define MESH_ROWS_PER_ITEM 16
+
+typedef struct {
+    const GeoSlice *geo;            /* Corner mesh in data units */
+    const unsigned long *pixels;    /* Cell colors, width x height */
+    const unsigned char *mask;      /* Cells to draw (NULL = all) */
+    double ox, oy;                  /* Frame position of (xmin, ymax) */
+    double xmin, ymax, sx, sy;
+} MeshJob;
+
+/* Fill triangle (x0,y0)-(x1,y1)-(x2,y2) in frame rows [row0, row1): each
+ * row keeps the pixels whose centres lie on the inner side of all three
+ * edges, found as one x interval per edge */
+static void mesh_fill_triangle(double x0, double y0, double x1, double y1, double x2, double y2,
+                               int row0, int row1, unsigned long pixel) {
+    double ex[3][3];
+    double area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+    int e, row, col;
+
+    if (area == 0.0) return;
+    double s = area > 0 ? 1.0 : -1.0;
+    double vx[3] = { x0, x1, x2 }, vy[3] = { y0, y1, y2 };
+    for (e = 0; e < 3; e++) {
+        int n = (e + 1) % 3;
+        /* Inside: a * x + b * y + c >= 0 */
+        ex[e][0] = s * (vy[e] - vy[n]);
+        ex[e][1] = s * (vx[n] - vx[e]);
+        ex[e][2] = s * (vx[e] * vy[n] - vx[n] * vy[e]);
+    }
+
+    double ymin = fmin(y0, fmin(y1, y2)), ymax = fmax(y0, fmax(y1, y2));
+    int r0 = (int)ceil(ymin - 0.5), r1 = (int)floor(ymax - 0.5) + 1;
+    if (r0 < row0) r0 = row0;
+    if (r1 > row1) r1 = row1;
+
+    for (row = r0; row < r1; row++) {
+        double py = row + 0.5;
+        double xl = 0.0, xr = frame_w;
+        for (e = 0; e < 3; e++) {
+            double rest = ex[e][1] * py + ex[e][2];
+            if (ex[e][0] > 0) {
+                double b = -rest / ex[e][0];
+                if (b > xl) xl = b;
+            } else if (ex[e][0] < 0) {
+                double b = -rest / ex[e][0];
+                if (b < xr) xr = b;
+            } else if (rest < 0) {
+                xr = -1.0;
+            }
+        }
+        int c0 = (int)ceil(xl - 0.5), c1 = (int)floor(xr - 0.5);
+        if (c0 < 0) c0 = 0;
+        if (c1 >= frame_w) c1 = frame_w - 1;
+        for (col = c0; col <= c1; col++) frame_store(col, row, pixel);
+    }
+}
+
+static void mesh_rows(void *ctx, int item) {
+    const MeshJob *job = (const MeshJob *)ctx;
+    const GeoSlice *geo = job->geo;
+    int row0 = item * MESH_ROWS_PER_ITEM;
+    int row1 = row0 + MESH_ROWS_PER_ITEM;
+    int i, j, stride = geo->width + 1;
+    double ox = job->ox, oy = job->oy, xmin = job->xmin, ymax = job->ymax;
+    double sx = job->sx, sy = job->sy;
+
+    if (row1 > frame_h) row1 = frame_h;
+    for (j = 0; j < geo->height; j++) {
+        double y0 = oy + (ymax - geo->strip_hi[j]) * sy, y1 = oy + (ymax - geo->strip_lo[j]) * sy;
+        if (fmax(y0, y1) < row0 || fmin(y0, y1) > row1) continue;
+        const double *cx = geo->corner_x + (size_t)j * stride;
+        const double *cy = geo->corner_y + (size_t)j * stride;
+        for (i = 0; i < geo->width; i++) {
+            size_t cell = (size_t)j * geo->width + i;
+            if (job->mask && !job->mask[cell]) continue;
+            /* Corners (i, j), (i+1, j), (i+1, j+1), (i, j+1) in frame coordinates */
+            double ax = ox + (cx[i] - xmin) * sx, ay = oy + (ymax - cy[i]) * sy;
+            double bx = ox + (cx[i + 1] - xmin) * sx, by = oy + (ymax - cy[i + 1]) * sy;
+            double cxx = ox + (cx[stride + i + 1] - xmin) * sx;
+            double cyy = oy + (ymax - cy[stride + i + 1]) * sy;
+            double dx = ox + (cx[stride + i] - xmin) * sx, dy = oy + (ymax - cy[stride + i]) * sy;
+            if (fmax(fmax(ay, by), fmax(cyy, dy)) < row0 ||
+                fmin(fmin(ay, by), fmin(cyy, dy)) > row1) continue;
+            if (fmax(fmax(ax, bx), fmax(cxx, dx)) < 0 ||
+                fmin(fmin(ax, bx), fmin(cxx, dx)) > frame_w) continue;
+            mesh_fill_triangle(ax, ay, bx, by, cxx, cyy, row0, row1, job->pixels[cell]);
+            mesh_fill_triangle(ax, ay, cxx, cyy, dx, dy, row0, row1, job->pixels[cell]);
+        }
+    }
+}
+
+/* Rasterize the cell mesh of a geo slice into the frame. Corners in data
+ * units map to canvas x = base_x + (x - xmin) * sx and y = base_y +
+ * (ymax - y) * sy. Cells with mask == 0 are skipped (mask may be NULL).
+ * Returns -1 when the slice has no mesh (fewer than 2 cells along an axis,
+ * or no memory for one). Nothing is allocated per frame. */
+static int frame_raster_mesh(const GeoSlice *geo, const unsigned long *pixels,
+                             const unsigned char *mask, double xmin, double ymax,
+                             double sx, double sy, int base_x, int base_y) {
+    if (!geo->corner_x) return -1;
+    if (frame_w <= 0) return 0;
+
+    MeshJob job = { geo, pixels, mask, base_x - frame_x, base_y - frame_y, xmin, ymax, sx, sy };
+    pool_run(mesh_rows, &job, (frame_h + MESH_ROWS_PER_ITEM - 1) / MESH_ROWS_PER_ITEM);
+    return 0;
+}
+
+/* What the axes around the data area need, so a pan can redraw them
+ * without re-rendering the slice */
+static struct {
+    double phys_xmin, phys_xmax, phys_ymin, phys_ymax;
+    int x_axis, y_axis;
+    int left_margin;
+    char stats_text[128];
+} slice_axes;
+
+/* Draw the axis frame, ticks and labels for the current zoom scroll, and
+ * the stats line, into the canvas pixmap */
+static void draw_slice_axes(PlotfileData *pf) {
+    double phys_xmin = slice_axes.phys_xmin, phys_xmax = slice_axes.phys_xmax;
+    double phys_ymin = slice_axes.phys_ymin, phys_ymax = slice_axes.phys_ymax;
+    int i;
+
+    /* Use visible area coordinates for axis frame/labels */
+    int axis_ox = vis_area_x;
+    int axis_oy = vis_area_y;
+    int axis_w = vis_area_w;
+    int axis_h = vis_area_h;
+
+    /* Compute visible physical range when zoomed */
+    double vis_phys_xmin = phys_xmin, vis_phys_xmax = phys_xmax;
+    double vis_phys_ymin = phys_ymin, vis_phys_ymax = phys_ymax;
+    if (zoom_level > 1.0) {
+        int zoomed_rw = render_width;
+        int zoomed_rh = render_height;
+        double vis_frac_lo_x = (double)zoom_scroll_x / zoomed_rw;
+        double vis_frac_hi_x = (double)(zoom_scroll_x + vis_area_w) / zoomed_rw;
+        double vis_frac_lo_y = (double)zoom_scroll_y / zoomed_rh;
+        double vis_frac_hi_y = (double)(zoom_scroll_y + vis_area_h) / zoomed_rh;
+        vis_phys_xmin = phys_xmin + vis_frac_lo_x * (phys_xmax - phys_xmin);
+        vis_phys_xmax = phys_xmin + vis_frac_hi_x * (phys_xmax - phys_xmin);
+        /* Y is flipped: top of screen = high y, bottom = low y */
+        vis_phys_ymin = phys_ymin + (1.0 - vis_frac_hi_y) * (phys_ymax - phys_ymin);
+        vis_phys_ymax = phys_ymin + (1.0 - vis_frac_lo_y) * (phys_ymax - phys_ymin);
+    }
+
+    /* Draw axis frame (border around data) */
+    XSetForeground(display, text_gc, BlackPixel(display, screen));
+    XDrawRectangle(display, pixmap, text_gc, axis_ox, axis_oy, axis_w, axis_h);
 
-        /* Close button */
-        n = 0;
-        XtSetArg(args[n], XtNfromVert, prev_button); n++;
-        XtSetArg(args[n], XtNlabel, "Close"); n++;
-        button = XtCreateManagedWidget("close", commandWidgetClass, form, args, n);
-        XtAddCallback(button, XtNcallback, cmap_dialog_close_callback, (XtPointer)dialog_shell);
+    /* Draw X-axis ticks and labels */
+    int n_xticks = 5;
+    char label[32];
+    for (i = 0; i <= n_xticks; i++) {
+        double frac = (double)i / n_xticks;
+        int tick_x = axis_ox + (int)(frac * axis_w);
+        double phys_val = vis_phys_xmin + frac * (vis_phys_xmax - vis_phys_xmin);
 
-        XtRealizeWidget(dialog_shell);
-        XtPopup(dialog_shell, XtGrabNone);
-    }
-}
+        /* Draw tick mark */
+        XDrawLine(display, pixmap, text_gc, tick_x, axis_oy + axis_h,
+              tick_x, axis_oy + axis_h + 5);
 
-/* Canvas expose callback */
-void canvas_expose_callback(Widget w, XtPointer client_data, XtPointer call_data) {
-    if (global_pf && global_pf->data) {
-        render_slice(global_pf);
+        /* Draw label */
+        snprintf(label, sizeof(label), "%.3g", phys_val);
+        int label_width = XTextWidth(font, label, strlen(label));
+        XDrawString(display, pixmap, text_gc, tick_x - label_width / 2,
+                axis_oy + axis_h + 18, label, strlen(label));
     }
-}
 
-/* Colorbar expose callback */
-void colorbar_expose_callback(Widget w, XtPointer client_data, XtPointer call_data) {
-    if (global_pf) {
-        draw_colorbar(current_vmin, current_vmax, global_pf->colormap,
-                      global_pf->variables[global_pf->current_var]);
-    }
-}
+    /* Draw Y-axis ticks and labels */
+    int n_yticks = 5;
+    for (i = 0; i <= n_yticks; i++) {
+        double frac = (double)i / n_yticks;
+        int tick_y = axis_oy + axis_h - (int)(frac * axis_h);
+        double phys_val = vis_phys_ymin + frac * (vis_phys_ymax - vis_phys_ymin);
 
-static void draw_y_label_ccw(const char *label, int x, int y_center) {
-    if (!label || !label[0] || !font) return;
+        /* Draw tick mark */
+        XDrawLine(display, pixmap, text_gc, axis_ox - 5, tick_y, axis_ox, tick_y);
 
-    int len = (int)strlen(label);
-    int text_w = XTextWidth(font, label, len);
-    int text_h = font->ascent + font->descent;
-    if (text_w <= 0 || text_h <= 0) return;
+        /* Draw label */
+        snprintf(label, sizeof(label), "%.3g", phys_val);
+        int label_width = XTextWidth(font, label, strlen(label));
+        XDrawString(display, pixmap, text_gc, axis_ox - label_width - 8,
+                    tick_y + 4, label, strlen(label));
+    }
 
-    Pixmap tmp = XCreatePixmap(display, canvas, text_w, text_h,
-                               DefaultDepth(display, screen));
-    if (!tmp) return;
+    /* Draw axis labels with units */
+    const char *axis_names[] = {"X", "Y", "Z"};
+    char x_label[32], y_label[32];
 
-    GC tmp_gc = XCreateGC(display, tmp, 0, NULL);
-    if (!tmp_gc) {
-        XFreePixmap(display, tmp);
-        return;
+    if (pf->map_mode) {
+        /* Map mode: axis labels depend on slice axis */
+        if (pf->slice_axis == 2) {
+            /* Z-slice: lon on X, lat on Y */
+            strcpy(x_label, "Longitude (deg)");
+            strcpy(y_label, "Latitude (deg)");
+        } else if (pf->slice_axis == 1) {
+            /* Y-slice: lon on X, height on Y */
+            strcpy(x_label, "Longitude (deg)");
+            strcpy(y_label, "Height (m)");
+        } else {
+            /* X-slice: lat on X, height on Y */
+            strcpy(x_label, "Latitude (deg)");
+            strcpy(y_label, "Height (m)");
+        }
+    } else {
+        /* Normal mode: use physical coordinates with units */
+        const char *unit_str = "(m)";
+        snprintf(x_label, sizeof(x_label), "%s %s", axis_names[slice_axes.x_axis], unit_str);
+        snprintf(y_label, sizeof(y_label), "%s %s", axis_names[slice_axes.y_axis], unit_str);
     }
 
-    XSetForeground(display, tmp_gc, WhitePixel(display, screen));
-    XFillRectangle(display, tmp, tmp_gc, 0, 0, text_w, text_h);
-    XSetForeground(display, tmp_gc, BlackPixel(display, screen));
-    if (font) {
-        XSetFont(display, tmp_gc, font->fid);
-    }
-    XDrawString(display, tmp, tmp_gc, 0, font->ascent, label, len);
+    /* X-axis label (centered below ticks) */
+    int xlabel_width = XTextWidth(font, x_label, strlen(x_label));
+    XDrawString(display, pixmap, text_gc,
+                axis_ox + axis_w / 2 - xlabel_width / 2,
+                axis_oy + axis_h + 35, x_label, strlen(x_label));
 
-    XImage *src = XGetImage(display, tmp, 0, 0, text_w, text_h, AllPlanes, ZPixmap);
-    if (!src) {
-        XFreeGC(display, tmp_gc);
-        XFreePixmap(display, tmp);
-        return;
-    }
+    /* Y-axis label (rotated 90° CCW) */
+    int y_label_x = axis_ox - slice_axes.left_margin;
+    draw_y_label_ccw(y_label, y_label_x, axis_oy + axis_h / 2);
 
-    int dest_w = text_h;
-    int dest_h = text_w;
-    XImage *rot = XCreateImage(display, DefaultVisual(display, screen),
-                               DefaultDepth(display, screen), ZPixmap, 0, NULL,
-                               dest_w, dest_h, 32, 0);
-    if (!rot) {
-        XDestroyImage(src);
-        XFreeGC(display, tmp_gc);
-        XFreePixmap(display, tmp);
-        return;
-    }
-    rot->data = (char *)malloc((size_t)rot->bytes_per_line * (size_t)dest_h);
-    if (!rot->data) {
-        XDestroyImage(rot);
-        XDestroyImage(src);
-        XFreeGC(display, tmp_gc);
-        XFreePixmap(display, tmp);
-        return;
-    }
+    /* Stats line: display range and mean */
+    XSetForeground(display, text_gc, BlackPixel(display, screen));
+    XSetBackground(display, text_gc, WhitePixel(display, screen));
+    XDrawImageString(display, pixmap, text_gc, slice_axes.left_margin, canvas_height - 5,
+                    slice_axes.stats_text, strlen(slice_axes.stats_text));
+}
 
-    for (int y = 0; y < text_h; y++) {
-        for (int xx = 0; xx < text_w; xx++) {
-            unsigned long pixel = XGetPixel(src, xx, y);
-            int rx = y;
-            int ry = dest_h - 1 - xx;
-            XPutPixel(rot, rx, ry, pixel);
-        }
+/* Redraw the canvas for the current zoom scroll from the pan cache.
+ * Returns 0 when the cache does not cover the new view. */
+int pan_slice_from_cache(PlotfileData *pf) {
+    if (!pan_cache_valid || pan_cache_zoom != zoom_level) return 0;
+    if (zoom_scroll_x < pan_cache_x || zoom_scroll_y < pan_cache_y ||
+        zoom_scroll_x + vis_area_w > pan_cache_x + pan_cache_w ||
+        zoom_scroll_y + vis_area_h > pan_cache_y + pan_cache_h) {
+        return 0;
     }
 
-    int draw_y = y_center - dest_h / 2;
-    XPutImage(display, canvas, text_gc, rot, 0, 0, x, draw_y, dest_w, dest_h);
+    /* Keep mouse mapping in step with the new scroll */
+    render_offset_x = vis_area_x - zoom_scroll_x;
+    render_offset_y = vis_area_y - zoom_scroll_y;
 
-    XDestroyImage(rot);
-    XDestroyImage(src);
-    XFreeGC(display, tmp_gc);
-    XFreePixmap(display, tmp);
+    XSetForeground(display, gc, WhitePixel(display, screen));
+    XFillRectangle(display, pixmap, gc, 0, 0, canvas_width, canvas_height);
+    layer_show();
+    draw_slice_axes(pf);
+    XCopyArea(display, pixmap, canvas, gc, 0, 0, canvas_width, canvas_height, 0, 0);
+    XFlush(display);
+    return 1;
 }
+
 void render_slice(PlotfileData *pf) {
     int width, height;
     double *slice;
@@ -4056,7 +8046,6 @@ void render_slice(PlotfileData *pf) {
     double vsum = 0.0;
     int vcount = 0;
     int i, j;
-    char stats_text[128];
 
     /* Axis margin sizes */
     int left_margin = 60;    /* Space for Y-axis labels */
@@ -4064,6 +8053,10 @@ void render_slice(PlotfileData *pf) {
     int top_margin = 10;     /* Small top margin */
     int right_margin = 10;   /* Small right margin */
 
+    /* The pan cache holds the previous frame until this one is complete, so
+     * a render that stops early leaves panning to a full redraw */
+    pan_cache_valid = 0;
+
     /* Determine slice dimensions and physical coordinates */
     int x_axis, y_axis;  /* Which physical dimensions map to screen x,y */
     if (pf->slice_axis == 2) {       /* Z-slice: X horizontal, Y vertical */
@@ -4120,37 +8113,31 @@ void render_slice(PlotfileData *pf) {
      * non-contiguous boxes with zero-filled gaps in between) */
     unsigned char *base_in_box = NULL;
     if (pf->current_level > 0 && pf->n_boxes > 1) {
-        base_in_box = (unsigned char *)calloc(width * height, 1);
         int base_slice_coord = pf->slice_idx + pf->level_lo[pf->slice_axis];
-        for (int bi = 0; bi < pf->n_boxes; bi++) {
-            Box *box = &pf->boxes[bi];
-            if (base_slice_coord < box->lo[pf->slice_axis] || base_slice_coord > box->hi[pf->slice_axis])
-                continue;
-            int dim_x, dim_y;
-            if (pf->slice_axis == 2) { dim_x = 0; dim_y = 1; }
-            else if (pf->slice_axis == 1) { dim_x = 0; dim_y = 2; }
-            else { dim_x = 1; dim_y = 2; }
-            int mi_lo = box->lo[dim_x] - pf->level_lo[dim_x];
-            int mi_hi = box->hi[dim_x] - pf->level_lo[dim_x];
-            int mj_lo = box->lo[dim_y] - pf->level_lo[dim_y];
-            int mj_hi = box->hi[dim_y] - pf->level_lo[dim_y];
-            if (mi_lo < 0) mi_lo = 0;
-            if (mj_lo < 0) mj_lo = 0;
-            if (mi_hi >= width) mi_hi = width - 1;
-            if (mj_hi >= height) mj_hi = height - 1;
-            for (int mj = mj_lo; mj <= mj_hi; mj++)
-                for (int mi = mi_lo; mi <= mi_hi; mi++)
-                    base_in_box[mj * width + mi] = 1;
-        }
-    }
-
-    /* Find data min/max/mean, skipping gap cells when mask is active */
-    for (i = 0; i < width * height; i++) {
-        if (base_in_box && !base_in_box[i]) continue;
-        if (slice[i] < vmin) vmin = slice[i];
-        if (slice[i] > vmax) vmax = slice[i];
-        vsum += slice[i];
-        vcount++;
+        base_in_box = build_box_mask(pf->boxes, pf->n_boxes, &pf->box_index, pf->level_lo,
+                                     pf->slice_axis, base_slice_coord, width, height);
+    }
+
+    /* Level-of-detail pyramid for slices larger than the canvas */
+    slice_lod_update(pf, slice, base_in_box, width, height);
+
+    /* Find data min/max/mean, skipping gap cells when mask is active; an
+     * unmasked slice is summarized by the plane index */
+    const Moments *slice_planes = base_in_box ? NULL : plane_index_lookup(pf, pf->slice_axis);
+    if (slice_planes) {
+        const Moments *pm = &slice_planes[pf->slice_idx];
+        vmin = pm->min;
+        vmax = pm->max;
+        vsum = pm->mean * pm->n;
+        vcount = (int)pm->n;
+    } else {
+        for (i = 0; i < width * height; i++) {
+            if (base_in_box && !base_in_box[i]) continue;
+            if (slice[i] < vmin) vmin = slice[i];
+            if (slice[i] > vmax) vmax = slice[i];
+            vsum += slice[i];
+            vcount++;
+        }
     }
 
     /* When overlay mode is on, include all overlay levels in min/max for consistent colorbar */
@@ -4205,46 +8192,12 @@ void render_slice(PlotfileData *pf) {
 
             if (lev_slice_idx < 0 || lev_slice_idx >= ld->grid_dims[pf->slice_axis]) continue;
 
-            /* Extract slice and find min/max */
+            /* Min/max over cells inside actual boxes, not zero-filled gaps */
             int lw, lh;
             if (pf->slice_axis == 2) { lw = ld->grid_dims[0]; lh = ld->grid_dims[1]; }
             else if (pf->slice_axis == 1) { lw = ld->grid_dims[0]; lh = ld->grid_dims[2]; }
             else { lw = ld->grid_dims[1]; lh = ld->grid_dims[2]; }
-
-            double *lev_slice = (double *)malloc(lw * lh * sizeof(double));
-            extract_slice_level(ld, lev_slice, pf->slice_axis, lev_slice_idx);
-
-            /* Build mask so we only consider cells inside actual boxes, not zero-filled gaps */
-            unsigned char *mm_in_box = (unsigned char *)calloc(lw * lh, 1);
-            int mm_slice_coord = lev_slice_idx + ld->level_lo[pf->slice_axis];
-            for (int bi = 0; bi < ld->n_boxes; bi++) {
-                Box *box = &ld->boxes[bi];
-                if (mm_slice_coord < box->lo[pf->slice_axis] || mm_slice_coord > box->hi[pf->slice_axis])
-                    continue;
-                int dim_x, dim_y;
-                if (pf->slice_axis == 2) { dim_x = 0; dim_y = 1; }
-                else if (pf->slice_axis == 1) { dim_x = 0; dim_y = 2; }
-                else { dim_x = 1; dim_y = 2; }
-                int mi_lo = box->lo[dim_x] - ld->level_lo[dim_x];
-                int mi_hi = box->hi[dim_x] - ld->level_lo[dim_x];
-                int mj_lo = box->lo[dim_y] - ld->level_lo[dim_y];
-                int mj_hi = box->hi[dim_y] - ld->level_lo[dim_y];
-                if (mi_lo < 0) mi_lo = 0;
-                if (mj_lo < 0) mj_lo = 0;
-                if (mi_hi >= lw) mi_hi = lw - 1;
-                if (mj_hi >= lh) mj_hi = lh - 1;
-                for (int mj = mj_lo; mj <= mj_hi; mj++)
-                    for (int mi = mi_lo; mi <= mi_hi; mi++)
-                        mm_in_box[mj * lw + mi] = 1;
-            }
-
-            for (int j = 0; j < lw * lh; j++) {
-                if (!mm_in_box[j]) continue;
-                if (lev_slice[j] < vmin) vmin = lev_slice[j];
-                if (lev_slice[j] > vmax) vmax = lev_slice[j];
-            }
-            free(mm_in_box);
-            free(lev_slice);
+            level_plane_minmax(ld, pf->slice_axis, lev_slice_idx, lw, lh, &vmin, &vmax);
         }
     }
 
@@ -4267,7 +8220,7 @@ void render_slice(PlotfileData *pf) {
 
     /* Clear canvas with white background */
     XSetForeground(display, gc, WhitePixel(display, screen));
-    XFillRectangle(display, canvas, gc, 0, 0, canvas_width, canvas_height);
+    XFillRectangle(display, pixmap, gc, 0, 0, canvas_width, canvas_height);
 
     /* Declare rendering variables */
     int offset_x, offset_y, local_render_width, local_render_height;
@@ -4278,82 +8231,31 @@ void render_slice(PlotfileData *pf) {
         int lon_idx = find_variable_index(pf, "lon_m");
         int lat_idx = find_variable_index(pf, "lat_m");
         
+        /* Coordinates along each screen axis, cached per plane */
+        const GeoSlice *geo = NULL;
         if (lon_idx >= 0 && lat_idx >= 0) {
-            /* Determine which geographic coordinate to use based on slice axis */
-            double *x_geo_slice, *y_coord_slice;  /* Geographic x-axis and actual y-coordinate */
-            double *x_geo_extent, *y_coord_extent;
-            const char *x_label, *y_label;
-            
+            double dz = (pf->prob_hi[2] - pf->prob_lo[2]) / pf->grid_dims[2];
             if (pf->slice_axis == 2) {
                 /* Z-slice: longitude as x, latitude as y (normal map view) */
-                x_geo_slice = (double *)malloc(width * height * sizeof(double));
-                y_coord_slice = (double *)malloc(width * height * sizeof(double));
-                x_geo_extent = x_geo_slice; 
-                y_coord_extent = y_coord_slice;
-                x_label = "lon_m"; y_label = "lat_m";
-                
-                int prev_var = pf->current_var;
-                read_variable_data(pf, lon_idx);
-                extract_slice_from_data(pf->data, pf, x_geo_slice, pf->slice_axis, pf->slice_idx);
-                read_variable_data(pf, lat_idx);
-                extract_slice_from_data(pf->data, pf, y_coord_slice, pf->slice_axis, pf->slice_idx);
-                read_variable_data(pf, prev_var);
+                geo = geo_slice_get(pf, pf->current_level, lon_idx, lat_idx, pf->slice_axis,
+                                    pf->slice_idx, width, height, 0.0, 0.0);
             } else if (pf->slice_axis == 1) {
                 /* Y-slice: longitude as x, Z as y */
-                x_geo_slice = (double *)malloc(width * height * sizeof(double));
-                y_coord_slice = (double *)malloc(width * height * sizeof(double));
-                x_geo_extent = x_geo_slice;
-                y_coord_extent = y_coord_slice;
-                x_label = "lon_m"; y_label = "Z";
-                
-                int prev_var = pf->current_var;
-                read_variable_data(pf, lon_idx);
-                extract_slice_from_data(pf->data, pf, x_geo_slice, pf->slice_axis, pf->slice_idx);
-                read_variable_data(pf, prev_var);
-                
-                /* Generate Z coordinates for this slice */
-                for (j = 0; j < height; j++) {
-                    for (i = 0; i < width; i++) {
-                        int idx = j * width + i;
-                        /* Map grid index to physical Z coordinate */
-                        double z_coord = pf->prob_lo[2] + (j + 0.5) * (pf->prob_hi[2] - pf->prob_lo[2]) / pf->grid_dims[2];
-                        y_coord_slice[idx] = z_coord;
-                    }
-                }
+                geo = geo_slice_get(pf, pf->current_level, lon_idx, -1, pf->slice_axis,
+                                    pf->slice_idx, width, height, pf->prob_lo[2], dz);
             } else {
                 /* X-slice: latitude as x, Z as y */
-                x_geo_slice = (double *)malloc(width * height * sizeof(double));
-                y_coord_slice = (double *)malloc(width * height * sizeof(double));
-                x_geo_extent = x_geo_slice;
-                y_coord_extent = y_coord_slice;
-                x_label = "lat_m"; y_label = "Z";
-                
-                int prev_var = pf->current_var;
-                read_variable_data(pf, lat_idx);
-                extract_slice_from_data(pf->data, pf, x_geo_slice, pf->slice_axis, pf->slice_idx);
-                read_variable_data(pf, prev_var);
-                
-                /* Generate Z coordinates for this slice */
-                for (j = 0; j < height; j++) {
-                    for (i = 0; i < width; i++) {
-                        int idx = j * width + i;
-                        /* Map grid index to physical Z coordinate */
-                        double z_coord = pf->prob_lo[2] + (j + 0.5) * (pf->prob_hi[2] - pf->prob_lo[2]) / pf->grid_dims[2];
-                        y_coord_slice[idx] = z_coord;
-                    }
-                }
+                geo = geo_slice_get(pf, pf->current_level, lat_idx, -1, pf->slice_axis,
+                                    pf->slice_idx, width, height, pf->prob_lo[2], dz);
             }
-            
+        }
+
+        if (geo) {
+            const double *x_geo_extent = geo->x, *y_coord_extent = geo->y;
+
             /* Find actual data extent */
-            double data_x_min = x_geo_extent[0], data_x_max = x_geo_extent[0];
-            double data_y_min = y_coord_extent[0], data_y_max = y_coord_extent[0];
-            
-            for (i = 0; i < width * height; i++) {
-                if (x_geo_extent[i] < data_x_min) data_x_min = x_geo_extent[i];
-                if (x_geo_extent[i] > data_x_max) data_x_max = x_geo_extent[i];
-                if (y_coord_extent[i] < data_y_min) data_y_min = y_coord_extent[i];
-                if (y_coord_extent[i] > data_y_max) data_y_max = y_coord_extent[i];
-            }
+            double data_x_min = geo->x_min, data_x_max = geo->x_max;
+            double data_y_min = geo->y_min, data_y_max = geo->y_max;
             
             /* Add small padding around data */
             double x_range = data_x_max - data_x_min;
@@ -4408,46 +8310,46 @@ void render_slice(PlotfileData *pf) {
             int zoom_base_x = offset_x - zoom_scroll_x;
             int zoom_base_y = offset_y - zoom_scroll_y;
 
-            if (zoom_level > 1.0) {
-                XRectangle clip = {offset_x, offset_y, local_render_width, local_render_height};
-                XSetClipRectangles(display, gc, 0, 0, &clip, 1, Unsorted);
-            }
+            layer_begin(zoomed_rw, zoomed_rh, zoom_base_x, zoom_base_y);
 
             /* Create pixel data for individual points */
             unsigned long *point_pixels = (unsigned long *)malloc(width * height * sizeof(unsigned long));
             apply_colormap(slice, width, height, point_pixels, display_vmin, display_vmax, pf->colormap);
 
-            /* Compute dot size from actual screen-space cell size so dots tile
-             * without gaps regardless of grid resolution or slice axis.
-             * +2 ensures overlap at boundaries. */
-            int dot_w = (int)ceil((double)zoomed_rw / width) + 2;
-            int dot_h = (int)ceil((double)zoomed_rh / height) + 2;
-            if (dot_w < 1) dot_w = 1;
-            if (dot_h < 1) dot_h = 1;
-
-            /* Render each data point at its coordinate */
-            for (j = 0; j < height; j++) {
-                for (i = 0; i < width; i++) {
-                    int idx = j * width + i;
-                    double x_coord = x_geo_extent[idx];
-                    double y_coord = y_coord_extent[idx];
-
-                    /* Map coordinates to screen coordinates */
-                    if (x_coord >= phys_xmin && x_coord <= phys_xmax && y_coord >= phys_ymin && y_coord <= phys_ymax) {
-                        int screen_x = zoom_base_x + (int)((x_coord - phys_xmin) / (phys_xmax - phys_xmin) * zoomed_rw);
-                        int screen_y = zoom_base_y + (int)((phys_ymax - y_coord) / (phys_ymax - phys_ymin) * zoomed_rh);
-
-                        /* Draw a rectangle for each data point */
-                        XSetForeground(display, gc, point_pixels[idx]);
-                        XFillRectangle(display, canvas, gc, screen_x, screen_y, dot_w, dot_h);
+            /* Rasterize the cell mesh; a single row or column of cells has
+             * no mesh and falls back to one dot per cell */
+            if (frame_raster_mesh(geo, point_pixels, NULL, phys_xmin, phys_ymax,
+                                  zoomed_rw / (phys_xmax - phys_xmin),
+                                  zoomed_rh / (phys_ymax - phys_ymin),
+                                  zoom_base_x, zoom_base_y) < 0) {
+                /* Compute dot size from actual screen-space cell size so dots tile
+                 * without gaps regardless of grid resolution or slice axis.
+                 * +2 ensures overlap at boundaries. */
+                int dot_w = (int)ceil((double)zoomed_rw / width) + 2;
+                int dot_h = (int)ceil((double)zoomed_rh / height) + 2;
+                if (dot_w < 1) dot_w = 1;
+                if (dot_h < 1) dot_h = 1;
+
+                /* Render each data point at its coordinate */
+                for (j = 0; j < height; j++) {
+                    for (i = 0; i < width; i++) {
+                        int idx = j * width + i;
+                        double x_coord = x_geo_extent[idx];
+                        double y_coord = y_coord_extent[idx];
+
+                        /* Map coordinates to screen coordinates */
+                        if (x_coord >= phys_xmin && x_coord <= phys_xmax && y_coord >= phys_ymin && y_coord <= phys_ymax) {
+                            int screen_x = zoom_base_x + (int)((x_coord - phys_xmin) / (phys_xmax - phys_xmin) * zoomed_rw);
+                            int screen_y = zoom_base_y + (int)((phys_ymax - y_coord) / (phys_ymax - phys_ymin) * zoomed_rh);
+
+                            /* Fill a rectangle for each data point */
+                            frame_fill_rect(screen_x, screen_y, dot_w, dot_h, point_pixels[idx]);
+                        }
                     }
                 }
             }
 
-            if (zoom_level > 1.0) XSetClipMask(display, gc, None);
-            
-            free(x_geo_slice);
-            free(y_coord_slice);
+
             free(point_pixels);
         } else {
             /* Fallback to normal rendering if lon/lat not available */
@@ -4457,8 +8359,6 @@ void render_slice(PlotfileData *pf) {
             phys_ymax = pf->prob_hi[y_axis];
 
             /* Use normal rendering code */
-            apply_colormap(slice, width, height, pixel_data, display_vmin, display_vmax, pf->colormap);
-
             int avail_width = canvas_width - left_margin - right_margin;
             int avail_height = canvas_height - top_margin - bottom_margin;
 
@@ -4497,39 +8397,12 @@ void render_slice(PlotfileData *pf) {
             int zoom_base_x = offset_x - zoom_scroll_x;
             int zoom_base_y = offset_y - zoom_scroll_y;
 
-            if (zoom_level > 1.0) {
-                XRectangle clip = {offset_x, offset_y, local_render_width, local_render_height};
-                XSetClipRectangles(display, gc, 0, 0, &clip, 1, Unsorted);
-            }
-
-            double pixel_width = (double)zoomed_rw / width;
-            double pixel_height = (double)zoomed_rh / height;
-
-            for (j = 0; j < height; j++) {
-                for (i = 0; i < width; i++) {
-                    if (base_in_box && !base_in_box[j * width + i]) continue;
-
-                    unsigned long pixel = pixel_data[j * width + i];
-                    XSetForeground(display, gc, pixel);
-
-                    int x = zoom_base_x + (int)(i * pixel_width);
-                    int flipped_j = height - 1 - j;
-                    int y = zoom_base_y + (int)(flipped_j * pixel_height);
-                    int w = (int)((i + 1) * pixel_width) - (int)(i * pixel_width);
-                    int h = (int)((flipped_j + 1) * pixel_height) - (int)(flipped_j * pixel_height);
-                    if (w < 1) w = 1;
-                    if (h < 1) h = 1;
-
-                    XFillRectangle(display, canvas, gc, x, y, w, h);
-                }
-            }
-
-            if (zoom_level > 1.0) XSetClipMask(display, gc, None);
+            layer_begin(zoomed_rw, zoomed_rh, zoom_base_x, zoom_base_y);
+            slice_lod_blit(zoomed_rw, zoomed_rh, zoom_base_x, zoom_base_y,
+                           display_vmin, display_vmax, pf->colormap);
         }
     } else {
-        /* Normal mode: apply colormap and render as regular grid */
-        apply_colormap(slice, width, height, pixel_data, display_vmin, display_vmax, pf->colormap);
-
+        /* Normal mode: render as regular grid */
         /* Available area for data (excluding margins) */
         int avail_width = canvas_width - left_margin - right_margin;
         int avail_height = canvas_height - top_margin - bottom_margin;
@@ -4576,51 +8449,11 @@ void render_slice(PlotfileData *pf) {
         int zoom_base_x = offset_x - zoom_scroll_x;
         int zoom_base_y = offset_y - zoom_scroll_y;
 
-        /* Set clip region to visible data area when zoomed */
-        if (zoom_level > 1.0) {
-            XRectangle clip = {offset_x, offset_y, local_render_width, local_render_height};
-            XSetClipRectangles(display, gc, 0, 0, &clip, 1, Unsorted);
-        }
-
-        /* Draw pixels as filled rectangles with correct aspect ratio */
-        double pixel_width = (double)zoomed_rw / width;
-        double pixel_height = (double)zoomed_rh / height;
-
-        /* Compute visible cell range for performance optimization */
-        int i_start = 0, i_end = width, j_start = 0, j_end = height;
-        if (zoom_level > 1.0) {
-            i_start = (int)((double)zoom_scroll_x / pixel_width);
-            i_end = (int)((double)(zoom_scroll_x + local_render_width) / pixel_width) + 2;
-            j_start = height - 1 - (int)((double)(zoom_scroll_y + local_render_height) / pixel_height) - 1;
-            j_end = height - 1 - (int)((double)zoom_scroll_y / pixel_height) + 2;
-            if (i_start < 0) i_start = 0;
-            if (i_end > width) i_end = width;
-            if (j_start < 0) j_start = 0;
-            if (j_end > height) j_end = height;
-        }
-
-        for (j = j_start; j < j_end; j++) {
-            for (i = i_start; i < i_end; i++) {
-                if (base_in_box && !base_in_box[j * width + i]) continue;
-
-                unsigned long pixel = pixel_data[j * width + i];
-                XSetForeground(display, gc, pixel);
-
-                int x = zoom_base_x + (int)(i * pixel_width);
-                /* Flip y-axis: higher j (higher y in data) should be at top of screen */
-                int flipped_j = height - 1 - j;
-                int y = zoom_base_y + (int)(flipped_j * pixel_height);
-                int w = (int)((i + 1) * pixel_width) - (int)(i * pixel_width);
-                int h = (int)((flipped_j + 1) * pixel_height) - (int)(flipped_j * pixel_height);
-                if (w < 1) w = 1;
-                if (h < 1) h = 1;
-
-                XFillRectangle(display, canvas, gc, x, y, w, h);
-            }
-        }
-
-        /* Reset clip for non-data elements */
-        if (zoom_level > 1.0) XSetClipMask(display, gc, None);
+        /* Scale the cells (or a coarser LOD level) into the frame with
+         * correct aspect ratio; cells outside the frame are clipped */
+        layer_begin(zoomed_rw, zoomed_rh, zoom_base_x, zoom_base_y);
+        slice_lod_blit(zoomed_rw, zoomed_rh, zoom_base_x, zoom_base_y,
+                       display_vmin, display_vmax, pf->colormap);
     }
 
     /* Store rendering parameters for mouse interaction (use zoomed values) */
@@ -4641,8 +8474,6 @@ void render_slice(PlotfileData *pf) {
         offset_y = render_offset_y;
         local_render_width = render_width;
         local_render_height = render_height;
-        XRectangle clip = {vis_area_x, vis_area_y, vis_area_w, vis_area_h};
-        XSetClipRectangles(display, gc, 0, 0, &clip, 1, Unsorted);
     }
 
     /* Overlay higher levels if overlay_mode is enabled */
@@ -4659,6 +8490,10 @@ void render_slice(PlotfileData *pf) {
             dx0[i] = (pf->prob_hi[i] - pf->prob_lo[i]) / level0_dims[i];
         }
 
+        /* Levels to composite in one pass once the loop has set them up */
+        CompositeLevel composite[MAX_LEVELS];
+        int n_composite = 0;
+
         /* Only overlay levels HIGHER than the current level being displayed */
         int start_level = pf->current_level + 1;
         printf("render_slice: Overlay loop from level %d to %d\n", start_level, pf->n_levels - 1);
@@ -4787,76 +8622,22 @@ void render_slice(PlotfileData *pf) {
 
                 if (geo_x_var < 0) goto skip_map_overlay;
 
-                /* Read geo coordinate data for this level by temporarily using ld->data.
-                 * Save and restore the original variable data pointer. */
-                double *saved_data = ld->data;
-
-                ld->data = NULL;
-                read_variable_data_level(pf, geo_x_var, level);
-                double *geo_x_3d = ld->data;
-
-                double *geo_y_3d = NULL;
-                if (need_geo_y && geo_y_var >= 0) {
-                    ld->data = NULL;
-                    read_variable_data_level(pf, geo_y_var, level);
-                    geo_y_3d = ld->data;
-                }
-
-                ld->data = saved_data;
-
-                if (!geo_x_3d) goto skip_map_overlay;
-
-                /* Extract 2D geo coordinate slices */
-                double *geo_x_slice = (double *)malloc(lwidth * lheight * sizeof(double));
-                double *geo_y_slice = (double *)malloc(lwidth * lheight * sizeof(double));
-
-                /* Extract x-axis geographic coordinates using temporary data swap */
-                ld->data = geo_x_3d;
-                extract_slice_level(ld, geo_x_slice, pf->slice_axis, level_slice_idx);
-
-                /* Extract or compute y-axis coordinates */
-                if (need_geo_y && geo_y_3d) {
-                    ld->data = geo_y_3d;
-                    extract_slice_level(ld, geo_y_slice, pf->slice_axis, level_slice_idx);
-                } else {
-                    /* Y-axis is physical Z coordinate */
-                    for (int lj = 0; lj < lheight; lj++) {
-                        double z_phys = pf->prob_lo[2] +
-                            (ld->level_lo[2] + lj + 0.5) * dx_level[2];
-                        for (int li = 0; li < lwidth; li++) {
-                            geo_y_slice[lj * lwidth + li] = z_phys;
-                        }
-                    }
-                }
-
-                ld->data = saved_data;
+                /* Geo coordinates of the current plane of this level, or the
+                 * physical Z of each row for the y-axis of vertical slices */
+                const GeoSlice *geo_level = geo_slice_get(
+                    pf, level, geo_x_var, need_geo_y ? geo_y_var : -1, pf->slice_axis,
+                    level_slice_idx, lwidth, lheight,
+                    pf->prob_lo[2] + ld->level_lo[2] * dx_level[2], dx_level[2]);
+                if (!geo_level) goto skip_map_overlay;
+                const double *geo_x_slice = geo_level->x, *geo_y_slice = geo_level->y;
 
                 /* Compute slice_coord for box intersection test */
                 int map_slice_coord = level_slice_idx + ld->level_lo[pf->slice_axis];
 
                 /* Build in_box mask for this level */
-                unsigned char *map_in_box = (unsigned char *)calloc(lwidth * lheight, 1);
-                for (int bi = 0; bi < ld->n_boxes; bi++) {
-                    Box *box = &ld->boxes[bi];
-                    if (map_slice_coord < box->lo[pf->slice_axis] ||
-                        map_slice_coord > box->hi[pf->slice_axis])
-                        continue;
-                    int dim_x, dim_y;
-                    if (pf->slice_axis == 2) { dim_x = 0; dim_y = 1; }
-                    else if (pf->slice_axis == 1) { dim_x = 0; dim_y = 2; }
-                    else { dim_x = 1; dim_y = 2; }
-                    int mli_lo = box->lo[dim_x] - ld->level_lo[dim_x];
-                    int mli_hi = box->hi[dim_x] - ld->level_lo[dim_x];
-                    int mlj_lo = box->lo[dim_y] - ld->level_lo[dim_y];
-                    int mlj_hi = box->hi[dim_y] - ld->level_lo[dim_y];
-                    if (mli_lo < 0) mli_lo = 0;
-                    if (mlj_lo < 0) mlj_lo = 0;
-                    if (mli_hi >= lwidth) mli_hi = lwidth - 1;
-                    if (mlj_hi >= lheight) mlj_hi = lheight - 1;
-                    for (int mj = mlj_lo; mj <= mlj_hi; mj++)
-                        for (int mi = mli_lo; mi <= mli_hi; mi++)
-                            map_in_box[mj * lwidth + mi] = 1;
-                }
+                unsigned char *map_in_box = build_box_mask(ld->boxes, ld->n_boxes, &ld->box_index,
+                                                           ld->level_lo, pf->slice_axis,
+                                                           map_slice_coord, lwidth, lheight);
 
                 /* Extract data slice and apply colormap */
                 double *map_level_slice = (double *)malloc(lwidth * lheight * sizeof(double));
@@ -4864,32 +8645,36 @@ void render_slice(PlotfileData *pf) {
                 unsigned long *map_level_pixels = (unsigned long *)malloc(lwidth * lheight * sizeof(unsigned long));
                 apply_colormap(map_level_slice, lwidth, lheight, map_level_pixels, display_vmin, display_vmax, pf->colormap);
 
-                /* Render data points at geo coordinates (finer grid than base level) */
-                for (int lj = 0; lj < lheight; lj++) {
-                    for (int li = 0; li < lwidth; li++) {
-                        if (!map_in_box[lj * lwidth + li]) continue;
-                        int idx = lj * lwidth + li;
-                        double x_coord = geo_x_slice[idx];
-                        double y_coord = geo_y_slice[idx];
-                        if (x_coord >= phys_xmin && x_coord <= phys_xmax &&
-                            y_coord >= phys_ymin && y_coord <= phys_ymax) {
-                            int sx = offset_x + (int)((x_coord - phys_xmin) / (phys_xmax - phys_xmin) * local_render_width);
-                            int sy = offset_y + (int)((phys_ymax - y_coord) / (phys_ymax - phys_ymin) * local_render_height);
-                            XSetForeground(display, gc, map_level_pixels[idx]);
-                            XFillRectangle(display, canvas, gc, sx - 1, sy - 1, 3, 3);
+                /* Rasterize the cells inside boxes (finer mesh than base level),
+                 * or draw them as dots when the level plane has no mesh */
+                if (frame_raster_mesh(geo_level, map_level_pixels, map_in_box,
+                                      phys_xmin, phys_ymax,
+                                      local_render_width / (phys_xmax - phys_xmin),
+                                      local_render_height / (phys_ymax - phys_ymin),
+                                      offset_x, offset_y) < 0) {
+                    for (int lj = 0; lj < lheight; lj++) {
+                        for (int li = 0; li < lwidth; li++) {
+                            if (!map_in_box[lj * lwidth + li]) continue;
+                            int idx = lj * lwidth + li;
+                            double x_coord = geo_x_slice[idx];
+                            double y_coord = geo_y_slice[idx];
+                            if (x_coord >= phys_xmin && x_coord <= phys_xmax &&
+                                y_coord >= phys_ymin && y_coord <= phys_ymax) {
+                                int sx = offset_x + (int)((x_coord - phys_xmin) / (phys_xmax - phys_xmin) * local_render_width);
+                                int sy = offset_y + (int)((phys_ymax - y_coord) / (phys_ymax - phys_ymin) * local_render_height);
+                                frame_fill_rect(sx - 1, sy - 1, 3, 3, map_level_pixels[idx]);
+                            }
                         }
                     }
                 }
 
-                /* Draw box boundaries as line segments following the geo coordinate grid */
-                XSetForeground(display, gc, 0xFF0000);  /* Red */
-                XSetLineAttributes(display, gc, 2, LineSolid, CapButt, JoinMiter);
+                /* Queue box boundaries as line segments following the geo coordinate grid */
 
-                for (int bi = 0; bi < ld->n_boxes; bi++) {
-                    Box *box = &ld->boxes[bi];
-                    if (map_slice_coord < box->lo[pf->slice_axis] ||
-                        map_slice_coord > box->hi[pf->slice_axis])
-                        continue;
+                int *map_hits = (int *)malloc((ld->n_boxes > 0 ? ld->n_boxes : 1) * sizeof(int));
+                int n_map_hits = boxes_on_plane(ld->boxes, ld->n_boxes, &ld->box_index,
+                                                pf->slice_axis, map_slice_coord, map_hits);
+                for (int bh = 0; bh < n_map_hits; bh++) {
+                    Box *box = &ld->boxes[map_hits[bh]];
 
                     int dim_x, dim_y;
                     if (pf->slice_axis == 2) { dim_x = 0; dim_y = 1; }
@@ -4915,7 +8700,7 @@ void render_slice(PlotfileData *pf) {
                         int sy0 = offset_y + (int)((phys_ymax - geo_y_slice[idx0]) / (phys_ymax - phys_ymin) * local_render_height);
                         int sx1 = offset_x + (int)((geo_x_slice[idx1] - phys_xmin) / (phys_xmax - phys_xmin) * local_render_width);
                         int sy1 = offset_y + (int)((phys_ymax - geo_y_slice[idx1]) / (phys_ymax - phys_ymin) * local_render_height);
-                        XDrawLine(display, canvas, gc, sx0, sy0, sx1, sy1);
+                        frame_add_box_segment(sx0, sy0, sx1, sy1);
                     }
 
                     /* Top edge: j = lj_hi, i varies */
@@ -4926,7 +8711,7 @@ void render_slice(PlotfileData *pf) {
                         int sy0 = offset_y + (int)((phys_ymax - geo_y_slice[idx0]) / (phys_ymax - phys_ymin) * local_render_height);
                         int sx1 = offset_x + (int)((geo_x_slice[idx1] - phys_xmin) / (phys_xmax - phys_xmin) * local_render_width);
                         int sy1 = offset_y + (int)((phys_ymax - geo_y_slice[idx1]) / (phys_ymax - phys_ymin) * local_render_height);
-                        XDrawLine(display, canvas, gc, sx0, sy0, sx1, sy1);
+                        frame_add_box_segment(sx0, sy0, sx1, sy1);
                     }
 
                     /* Left edge: i = li_lo, j varies */
@@ -4937,7 +8722,7 @@ void render_slice(PlotfileData *pf) {
                         int sy0 = offset_y + (int)((phys_ymax - geo_y_slice[idx0]) / (phys_ymax - phys_ymin) * local_render_height);
                         int sx1 = offset_x + (int)((geo_x_slice[idx1] - phys_xmin) / (phys_xmax - phys_xmin) * local_render_width);
                         int sy1 = offset_y + (int)((phys_ymax - geo_y_slice[idx1]) / (phys_ymax - phys_ymin) * local_render_height);
-                        XDrawLine(display, canvas, gc, sx0, sy0, sx1, sy1);
+                        frame_add_box_segment(sx0, sy0, sx1, sy1);
                     }
 
                     /* Right edge: i = li_hi, j varies */
@@ -4948,19 +8733,14 @@ void render_slice(PlotfileData *pf) {
                         int sy0 = offset_y + (int)((phys_ymax - geo_y_slice[idx0]) / (phys_ymax - phys_ymin) * local_render_height);
                         int sx1 = offset_x + (int)((geo_x_slice[idx1] - phys_xmin) / (phys_xmax - phys_xmin) * local_render_width);
                         int sy1 = offset_y + (int)((phys_ymax - geo_y_slice[idx1]) / (phys_ymax - phys_ymin) * local_render_height);
-                        XDrawLine(display, canvas, gc, sx0, sy0, sx1, sy1);
+                        frame_add_box_segment(sx0, sy0, sx1, sy1);
                     }
                 }
 
-                XSetLineAttributes(display, gc, 0, LineSolid, CapButt, JoinMiter);
-
+                free(map_hits);
                 free(map_in_box);
                 free(map_level_slice);
                 free(map_level_pixels);
-                free(geo_x_slice);
-                free(geo_y_slice);
-                free(geo_x_3d);
-                if (geo_y_3d) free(geo_y_3d);
 
                 printf("Overlay level %d (map mode): rendered data + boundaries, slice %d\n",
                        level, level_slice_idx);
@@ -4969,44 +8749,7 @@ void render_slice(PlotfileData *pf) {
                 continue;  /* Skip normal overlay rendering for this level */
             }
 
-            /* Extract slice from this level */
-            double *level_slice = (double *)malloc(lwidth * lheight * sizeof(double));
-            extract_slice_level(ld, level_slice, pf->slice_axis, level_slice_idx);
-
-            /* Build mask: only render cells that fall inside an actual box.
-             * Gaps between non-contiguous boxes are left unmasked (0) so the
-             * underlying coarser level shows through. */
-            unsigned char *in_box = (unsigned char *)calloc(lwidth * lheight, 1);
             int slice_coord = level_slice_idx + ld->level_lo[pf->slice_axis];
-            for (int bi = 0; bi < ld->n_boxes; bi++) {
-                Box *box = &ld->boxes[bi];
-                /* Check if this box intersects the current slice */
-                if (slice_coord < box->lo[pf->slice_axis] || slice_coord > box->hi[pf->slice_axis])
-                    continue;
-                /* Determine the 2D range this box covers in the slice plane */
-                int dim_x, dim_y;  /* which 3D dims map to li, lj */
-                if (pf->slice_axis == 2) { dim_x = 0; dim_y = 1; }
-                else if (pf->slice_axis == 1) { dim_x = 0; dim_y = 2; }
-                else { dim_x = 1; dim_y = 2; }
-                int li_lo = box->lo[dim_x] - ld->level_lo[dim_x];
-                int li_hi = box->hi[dim_x] - ld->level_lo[dim_x];
-                int lj_lo = box->lo[dim_y] - ld->level_lo[dim_y];
-                int lj_hi = box->hi[dim_y] - ld->level_lo[dim_y];
-                /* Clamp to grid bounds */
-                if (li_lo < 0) li_lo = 0;
-                if (lj_lo < 0) lj_lo = 0;
-                if (li_hi >= lwidth) li_hi = lwidth - 1;
-                if (lj_hi >= lheight) lj_hi = lheight - 1;
-                for (int mj = lj_lo; mj <= lj_hi; mj++) {
-                    for (int mi = li_lo; mi <= li_hi; mi++) {
-                        in_box[mj * lwidth + mi] = 1;
-                    }
-                }
-            }
-
-            /* Apply colormap to level slice */
-            unsigned long *level_pixels = (unsigned long *)malloc(lwidth * lheight * sizeof(unsigned long));
-            apply_colormap(level_slice, lwidth, lheight, level_pixels, display_vmin, display_vmax, pf->colormap);
 
             /* Map level physical bounds to screen coordinates */
             double frac_x_lo = (level_x_lo - phys_xmin) / (phys_xmax - phys_xmin);
@@ -5022,32 +8765,20 @@ void render_slice(PlotfileData *pf) {
             double lpixel_width = (double)(screen_x1 - screen_x0) / lwidth;
             double lpixel_height = (double)(screen_y1 - screen_y0) / lheight;
 
-            /* Draw level pixels, skipping cells not inside any box */
-            for (int lj = 0; lj < lheight; lj++) {
-                for (int li = 0; li < lwidth; li++) {
-                    if (!in_box[lj * lwidth + li]) continue;
-
-                    unsigned long pixel = level_pixels[lj * lwidth + li];
-                    XSetForeground(display, gc, pixel);
-
-                    int lx = screen_x0 + (int)(li * lpixel_width);
-                    int flipped_lj = lheight - 1 - lj;
-                    int ly = screen_y0 + (int)(flipped_lj * lpixel_height);
-                    int lw = (int)((li + 1) * lpixel_width) - (int)(li * lpixel_width);
-                    int lh = (int)((flipped_lj + 1) * lpixel_height) - (int)(flipped_lj * lpixel_height);
-                    if (lw < 1) lw = 1;
-                    if (lh < 1) lh = 1;
-
-                    XFillRectangle(display, canvas, gc, lx, ly, lw, lh);
-                }
+            /* Only cells inside an actual box are drawn; gaps between
+             * non-contiguous boxes let the coarser level show through */
+            if (composite_level_init(&composite[n_composite], ld, pf->slice_axis, level_slice_idx,
+                                     lwidth, lheight, screen_x0, screen_y0,
+                                     lpixel_width, lpixel_height) == 0) {
+                n_composite++;
             }
 
-            /* Draw box outlines for each actual box at this level */
-            XSetForeground(display, gc, 0xFF0000);  /* Red */
-            for (int bi = 0; bi < ld->n_boxes; bi++) {
-                Box *box = &ld->boxes[bi];
-                if (slice_coord < box->lo[pf->slice_axis] || slice_coord > box->hi[pf->slice_axis])
-                    continue;
+            /* Queue box outlines for each actual box at this level */
+            int *box_hits = (int *)malloc((ld->n_boxes > 0 ? ld->n_boxes : 1) * sizeof(int));
+            int n_box_hits = boxes_on_plane(ld->boxes, ld->n_boxes, &ld->box_index,
+                                            pf->slice_axis, slice_coord, box_hits);
+            for (int bh = 0; bh < n_box_hits; bh++) {
+                Box *box = &ld->boxes[box_hits[bh]];
                 int dim_x, dim_y;
                 if (pf->slice_axis == 2) { dim_x = 0; dim_y = 1; }
                 else if (pf->slice_axis == 1) { dim_x = 0; dim_y = 2; }
@@ -5064,155 +8795,56 @@ void render_slice(PlotfileData *pf) {
                 int bsx1 = offset_x + (int)(bfx_hi * render_width);
                 int bsy0 = offset_y + local_render_height - (int)(bfy_hi * local_render_height);
                 int bsy1 = offset_y + local_render_height - (int)(bfy_lo * local_render_height);
-                XDrawRectangle(display, canvas, gc, bsx0, bsy0, bsx1 - bsx0, bsy1 - bsy0);
+                frame_add_box_rect(bsx0, bsy0, bsx1 - bsx0, bsy1 - bsy0);
             }
-
-            free(in_box);
-
-            free(level_slice);
-            free(level_pixels);
+            free(box_hits);
 
             printf("Overlay level %d: slice %d, screen [%d,%d]-[%d,%d]\n",
                    level, level_slice_idx, screen_x0, screen_y0, screen_x1, screen_y1);
         }
-    }
-
-    /* Reset clip region before drawing axes and labels */
-    if (zoom_level > 1.0) XSetClipMask(display, gc, None);
-
-    /* Use visible area coordinates for axis frame/labels */
-    int axis_ox = vis_area_x;
-    int axis_oy = vis_area_y;
-    int axis_w = vis_area_w;
-    int axis_h = vis_area_h;
-
-    /* Compute visible physical range when zoomed */
-    double vis_phys_xmin = phys_xmin, vis_phys_xmax = phys_xmax;
-    double vis_phys_ymin = phys_ymin, vis_phys_ymax = phys_ymax;
-    if (zoom_level > 1.0) {
-        int zoomed_rw = render_width;
-        int zoomed_rh = render_height;
-        double vis_frac_lo_x = (double)zoom_scroll_x / zoomed_rw;
-        double vis_frac_hi_x = (double)(zoom_scroll_x + vis_area_w) / zoomed_rw;
-        double vis_frac_lo_y = (double)zoom_scroll_y / zoomed_rh;
-        double vis_frac_hi_y = (double)(zoom_scroll_y + vis_area_h) / zoomed_rh;
-        vis_phys_xmin = phys_xmin + vis_frac_lo_x * (phys_xmax - phys_xmin);
-        vis_phys_xmax = phys_xmin + vis_frac_hi_x * (phys_xmax - phys_xmin);
-        /* Y is flipped: top of screen = high y, bottom = low y */
-        vis_phys_ymin = phys_ymin + (1.0 - vis_frac_hi_y) * (phys_ymax - phys_ymin);
-        vis_phys_ymax = phys_ymin + (1.0 - vis_frac_lo_y) * (phys_ymax - phys_ymin);
-    }
-
-    /* Draw axis frame (border around data) */
-    XSetForeground(display, text_gc, BlackPixel(display, screen));
-    XDrawRectangle(display, canvas, text_gc, axis_ox, axis_oy, axis_w, axis_h);
 
-    /* Draw X-axis ticks and labels */
-    int n_xticks = 5;
-    char label[32];
-    for (i = 0; i <= n_xticks; i++) {
-        double frac = (double)i / n_xticks;
-        int tick_x = axis_ox + (int)(frac * axis_w);
-        double phys_val = vis_phys_xmin + frac * (vis_phys_xmax - vis_phys_xmin);
-
-        /* Draw tick mark */
-        XDrawLine(display, canvas, text_gc, tick_x, axis_oy + axis_h,
-              tick_x, axis_oy + axis_h + 5);
-
-        /* Draw label */
-        snprintf(label, sizeof(label), "%.3g", phys_val);
-        int label_width = XTextWidth(font, label, strlen(label));
-        XDrawString(display, canvas, text_gc, tick_x - label_width / 2,
-                axis_oy + axis_h + 18, label, strlen(label));
+        /* Color each covered pixel once, from the finest level over it */
+        frame_composite_levels(composite, n_composite, display_vmin, display_vmax, pf->colormap);
+        for (i = 0; i < n_composite; i++) composite_level_free(&composite[i]);
     }
 
-    /* Draw Y-axis ticks and labels */
-    int n_yticks = 5;
-    for (i = 0; i <= n_yticks; i++) {
-        double frac = (double)i / n_yticks;
-        int tick_y = axis_oy + axis_h - (int)(frac * axis_h);
-        double phys_val = vis_phys_ymin + frac * (vis_phys_ymax - vis_phys_ymin);
-
-        /* Draw tick mark */
-        XDrawLine(display, canvas, text_gc, axis_ox - 5, tick_y, axis_ox, tick_y);
+    /* Put the composed data area and box outlines in the pan cache */
+    frame_end();
 
-        /* Draw label */
-        snprintf(label, sizeof(label), "%.3g", phys_val);
-        int label_width = XTextWidth(font, label, strlen(label));
-        XDrawString(display, canvas, text_gc, axis_ox - label_width - 8,
-                    tick_y + 4, label, strlen(label));
+    /* Draw quiver overlay if enabled */
+    if (quiver_data.enabled) {
+        render_quiver_overlay(pf);
     }
 
-    /* Draw axis labels with units */
-    const char *axis_names[] = {"X", "Y", "Z"};
-    char x_label[32], y_label[32];
-
-    if (pf->map_mode) {
-        /* Map mode: axis labels depend on slice axis */
-        if (pf->slice_axis == 2) {
-            /* Z-slice: lon on X, lat on Y */
-            strcpy(x_label, "Longitude (deg)");
-            strcpy(y_label, "Latitude (deg)");
-        } else if (pf->slice_axis == 1) {
-            /* Y-slice: lon on X, height on Y */
-            strcpy(x_label, "Longitude (deg)");
-            strcpy(y_label, "Height (m)");
-        } else {
-            /* X-slice: lat on X, height on Y */
-            strcpy(x_label, "Latitude (deg)");
-            strcpy(y_label, "Height (m)");
-        }
-    } else {
-        /* Normal mode: use physical coordinates with units */
-        const char *unit_str = "(m)";
-        snprintf(x_label, sizeof(x_label), "%s %s", axis_names[x_axis], unit_str);
-        snprintf(y_label, sizeof(y_label), "%s %s", axis_names[y_axis], unit_str);
+    /* Draw map overlay (coastlines etc.) only for Z-slice in map mode */
+    if (pf->map_mode && pf->slice_axis == 2) {
+        render_map_overlay(pf, phys_xmin, phys_xmax, phys_ymin, phys_ymax);
     }
 
-    /* X-axis label (centered below ticks) */
-    int xlabel_width = XTextWidth(font, x_label, strlen(x_label));
-    XDrawString(display, canvas, text_gc,
-                axis_ox + axis_w / 2 - xlabel_width / 2,
-                axis_oy + axis_h + 35, x_label, strlen(x_label));
-
-    /* Y-axis label (rotated 90° CCW) */
-    int y_label_x = axis_ox - left_margin;
-    draw_y_label_ccw(y_label, y_label_x, axis_oy + axis_h / 2);
-
-    /* Draw text overlay - show display range (custom if set) */
+    /* Visible part of the data layer, then axes and labels around it */
+    layer_show();
+    slice_axes.phys_xmin = phys_xmin;
+    slice_axes.phys_xmax = phys_xmax;
+    slice_axes.phys_ymin = phys_ymin;
+    slice_axes.phys_ymax = phys_ymax;
+    slice_axes.x_axis = x_axis;
+    slice_axes.y_axis = y_axis;
+    slice_axes.left_margin = left_margin;
     if (use_custom_range) {
-        snprintf(stats_text, sizeof(stats_text), "range: %.3e to %.3e (custom)  mean: %.3e", display_vmin, display_vmax, vmean);
+        snprintf(slice_axes.stats_text, sizeof(slice_axes.stats_text), "range: %.3e to %.3e (custom)  mean: %.3e", display_vmin, display_vmax, vmean);
     } else {
-        snprintf(stats_text, sizeof(stats_text), "min: %.3e  max: %.3e  mean: %.3e", display_vmin, display_vmax, vmean);
+        snprintf(slice_axes.stats_text, sizeof(slice_axes.stats_text), "min: %.3e  max: %.3e  mean: %.3e", display_vmin, display_vmax, vmean);
     }
-    XSetForeground(display, text_gc, BlackPixel(display, screen));
-    XSetBackground(display, text_gc, WhitePixel(display, screen));
-    XDrawImageString(display, canvas, text_gc, left_margin, canvas_height - 5,
-                    stats_text, strlen(stats_text));
+    draw_slice_axes(pf);
 
     /* Draw colorbar */
     draw_colorbar(display_vmin, display_vmax, pf->colormap,
                   pf->variables[pf->current_var]);
 
-    /* Set clip region for quiver/map overlays when zoomed */
-    if (zoom_level > 1.0) {
-        XRectangle clip = {vis_area_x, vis_area_y, vis_area_w, vis_area_h};
-        XSetClipRectangles(display, gc, 0, 0, &clip, 1, Unsorted);
-    }
-
-    /* Draw quiver overlay if enabled */
-    if (quiver_data.enabled) {
-        render_quiver_overlay(pf);
-    }
-
-    /* Draw map overlay (coastlines etc.) only for Z-slice in map mode */
-    if (pf->map_mode && pf->slice_axis == 2) {
-        render_map_overlay(pf, phys_xmin, phys_xmax, phys_ymin, phys_ymax);
-    }
-
-    /* Reset clip after overlays */
-    if (zoom_level > 1.0) XSetClipMask(display, gc, None);
-
+    /* Show the finished frame; exposes repaint from the pixmap */
+    XCopyArea(display, pixmap, canvas, gc, 0, 0, canvas_width, canvas_height, 0, 0);
+    pixmap_valid = 1;
+    pan_cache_valid = pan_cache_w > 0;
     XFlush(display);
     
     printf("Rendered: %s, slice %d/%d (%.3e to %.3e)\n", 
@@ -5310,7 +8942,7 @@ void canvas_motion_handler(Widget w, XtPointer client_data, XEvent *event, Boole
             zoom_scroll_x = zoom_drag_scroll_x0 - dx;
             zoom_scroll_y = zoom_drag_scroll_y0 - dy;
             clamp_zoom_scroll();
-            render_slice(global_pf);
+            if (!pan_slice_from_cache(global_pf)) render_slice(global_pf);
             return;
         }
     }
@@ -5951,26 +9583,89 @@ void toggle_zlayer_callback(Widget w, XtPointer client_data, XtPointer call_data
         XClearArea(dpy, XtWindow(popup_data->skewness_canvas), 0, 0, 0, 0, True);
 }
 
+typedef struct {
+    const double *data;
+    const int *dims;
+    int axis;
+    int n_layers;
+    int planes_per_item;
+    Moments *layers;            /* Z: one per layer; X/Y: n_layers per item */
+} ProfileMomentsJob;
+
+/* Z profile: layer `item` is one contiguous plane */
+static void profile_z_layer(void *ctx, int item) {
+    const ProfileMomentsJob *job = (const ProfileMomentsJob *)ctx;
+    size_t plane = (size_t)job->dims[0] * job->dims[1];
+
+    moments_init(&job->layers[item]);
+    moments_add(&job->layers[item], job->data + item * plane, plane);
+}
+
+/* X/Y profile: sweep planes [k0, k1) in memory order, updating every
+ * layer's accumulator of this item as its cells go by */
+static void profile_xy_planes(void *ctx, int item) {
+    const ProfileMomentsJob *job = (const ProfileMomentsJob *)ctx;
+    size_t nx = job->dims[0], ny = job->dims[1], nz = job->dims[2];
+    size_t k0 = (size_t)item * job->planes_per_item;
+    size_t k1 = k0 + job->planes_per_item < nz ? k0 + job->planes_per_item : nz;
+    Moments *layers = job->layers + (size_t)item * job->n_layers;
+    size_t j, k;
+    int l;
+
+    for (l = 0; l < job->n_layers; l++) moments_init(&layers[l]);
+    if (job->axis == 1) {
+        /* Y layer j: row j of every plane */
+        for (k = k0; k < k1; k++) {
+            for (j = 0; j < ny; j++) moments_add(&layers[j], job->data + (k * ny + j) * nx, nx);
+        }
+    } else {
+        /* X layer i: column i of the rows, which run contiguously across planes */
+        moments_add_columns(layers, job->data + k0 * ny * nx, (k1 - k0) * ny, nx);
+    }
+}
+
+/* Moments of every layer along axis, written to layers[0..dims[axis]) */
+static void profile_moments(const double *data, const int dims[3], int axis, Moments *layers) {
+    int n_layers = dims[axis];
+    int l, item;
+
+    if (axis == 2) {
+        ProfileMomentsJob job = { data, dims, axis, n_layers, 0, layers };
+        pool_run(profile_z_layer, &job, n_layers);
+        return;
+    }
+
+    /* Split the planes over a few items per thread; each item keeps its
+     * own accumulators, merged afterwards in plane order */
+    int n_items = 4 * pool_thread_count();
+    if (n_items > dims[2]) n_items = dims[2];
+    int per_item = (dims[2] + n_items - 1) / n_items;
+    n_items = (dims[2] + per_item - 1) / per_item;
+    Moments *partial = (Moments *)malloc((size_t)n_items * n_layers * sizeof(Moments));
+    if (!partial) {
+        n_items = 1;
+        per_item = dims[2];
+        partial = layers;
+    }
+    ProfileMomentsJob job = { data, dims, axis, n_layers, per_item, partial };
+    pool_run(profile_xy_planes, &job, n_items);
+    if (partial == layers) return;
+
+    for (l = 0; l < n_layers; l++) {
+        layers[l] = partial[l];
+        for (item = 1; item < n_items; item++) {
+            moments_merge(&layers[l], &partial[(size_t)item * n_layers + l]);
+        }
+    }
+    free(partial);
+}
+
 /* Show slice statistics (mean and std) along current axis */
 void show_slice_statistics(PlotfileData *pf) {
     const char *axis_names[] = {"X", "Y", "Z"};
     int axis = pf->slice_axis;
     int n_slices = pf->grid_dims[axis];
 
-    /* Determine slice dimensions */
-    int slice_dim1, slice_dim2;
-    if (axis == 2) {  /* Z slices: X-Y planes */
-        slice_dim1 = pf->grid_dims[0];
-        slice_dim2 = pf->grid_dims[1];
-    } else if (axis == 1) {  /* Y slices: X-Z planes */
-        slice_dim1 = pf->grid_dims[0];
-        slice_dim2 = pf->grid_dims[2];
-    } else {  /* X slices: Y-Z planes */
-        slice_dim1 = pf->grid_dims[1];
-        slice_dim2 = pf->grid_dims[2];
-    }
-    int slice_size = slice_dim1 * slice_dim2;
-
     /* Allocate arrays for mean, std, and skewness */
     double *means = (double *)malloc(n_slices * sizeof(double));
     double *stds = (double *)malloc(n_slices * sizeof(double));
@@ -5979,66 +9674,35 @@ void show_slice_statistics(PlotfileData *pf) {
 
     /* Physical coordinate values (e.g., height in m for Z axis) */
     double *phys_values = (double *)malloc(n_slices * sizeof(double));
+    Moments *layer_moments = (Moments *)malloc(n_slices * sizeof(Moments));
+    if (!means || !stds || !skewness || !layer_indices || !phys_values || !layer_moments) {
+        fprintf(stderr, "Error: Cannot allocate memory for slice statistics\n");
+        free(means);
+        free(stds);
+        free(skewness);
+        free(layer_indices);
+        free(phys_values);
+        free(layer_moments);
+        return;
+    }
     double dphys = (pf->prob_hi[axis] - pf->prob_lo[axis]) / n_slices;
     for (int s = 0; s < n_slices; s++)
         phys_values[s] = pf->prob_lo[axis] + (s + 0.5) * dphys;
     double phys_min = phys_values[0];
     double phys_max = phys_values[n_slices - 1];
 
-    /* Calculate mean, std, and skewness for each slice */
+    /* Mean, std, and skewness for each slice, from the plane index when it
+     * describes this volume, otherwise in one sweep */
+    const Moments *indexed = plane_index_lookup(pf, axis);
+    if (indexed) memcpy(layer_moments, indexed, n_slices * sizeof(Moments));
+    else profile_moments(pf->data, pf->grid_dims, axis, layer_moments);
     for (int s = 0; s < n_slices; s++) {
         layer_indices[s] = s + 1;  /* 1-indexed for display */
-
-        double sum = 0.0;
-        double sum_sq = 0.0;
-
-        /* First pass: calculate mean and variance */
-        for (int j = 0; j < slice_dim2; j++) {
-            for (int i = 0; i < slice_dim1; i++) {
-                int idx;
-                if (axis == 2) {  /* Z slice */
-                    idx = s * pf->grid_dims[0] * pf->grid_dims[1] + j * pf->grid_dims[0] + i;
-                } else if (axis == 1) {  /* Y slice */
-                    idx = j * pf->grid_dims[0] * pf->grid_dims[1] + s * pf->grid_dims[0] + i;
-                } else {  /* X slice */
-                    idx = j * pf->grid_dims[0] * pf->grid_dims[1] + i * pf->grid_dims[0] + s;
-                }
-                double val = pf->data[idx];
-                sum += val;
-                sum_sq += val * val;
-            }
-        }
-
-        means[s] = sum / slice_size;
-        double variance = (sum_sq / slice_size) - (means[s] * means[s]);
-        stds[s] = (variance > 0) ? sqrt(variance) : 0.0;
-
-        /* Second pass: calculate skewness (third moment) */
-        double sum_third = 0.0;
-        for (int j = 0; j < slice_dim2; j++) {
-            for (int i = 0; i < slice_dim1; i++) {
-                int idx;
-                if (axis == 2) {  /* Z slice */
-                    idx = s * pf->grid_dims[0] * pf->grid_dims[1] + j * pf->grid_dims[0] + i;
-                } else if (axis == 1) {  /* Y slice */
-                    idx = j * pf->grid_dims[0] * pf->grid_dims[1] + s * pf->grid_dims[0] + i;
-                } else {  /* X slice */
-                    idx = j * pf->grid_dims[0] * pf->grid_dims[1] + i * pf->grid_dims[0] + s;
-                }
-                double val = pf->data[idx];
-                double diff = val - means[s];
-                sum_third += diff * diff * diff;
-            }
-        }
-
-        /* Skewness = E[(X - mu)^3] / sigma^3 */
-        if (stds[s] > 0) {
-            double std3 = stds[s] * stds[s] * stds[s];
-            skewness[s] = (sum_third / slice_size) / std3;
-        } else {
-            skewness[s] = 0.0;
-        }
+        means[s] = moments_mean(&layer_moments[s]);
+        stds[s] = moments_std(&layer_moments[s]);
+        skewness[s] = moments_skewness(&layer_moments[s]);
     }
+    free(layer_moments);
 
     /* Determine physical axis label: "Height (m)" for Z, otherwise axis name with units */
     const char *axis_labels[] = {"X (m)", "Y (m)", "Height (m)"};
@@ -6239,46 +9903,40 @@ static void draw_time_height_contour(Display *dpy, Window win, GC gc2,
     if (vmin == vmax) { vmin -= 0.5; vmax += 0.5; }
 
     /* Render contour image */
-    XImage *img = XCreateImage(dpy, DefaultVisual(dpy, screen),
-                               DefaultDepth(dpy, screen), ZPixmap, 0,
-                               NULL, plot_w, plot_h, 32, 0);
-    if (img) {
-        img->data = (char *)malloc(img->bytes_per_line * plot_h);
-        if (img->data) {
-            for (int py = 0; py < plot_h; py++) {
-                /* Map pixel row → z (top=zmax, bottom=zmin) */
-                double z_frac = 1.0 - (double)py / (plot_h - 1);
-                double z_target = zmin + z_frac * (zmax - zmin);
-                /* Find nearest z index */
-                int zi = 0;
-                double best = fabs(thc->z_values[0] - z_target);
-                for (int i = 1; i < thc->nz; i++) {
-                    double d = fabs(thc->z_values[i] - z_target);
-                    if (d < best) { best = d; zi = i; }
-                }
-                for (int px = 0; px < plot_w; px++) {
-                    /* Map pixel col → time index */
-                    double t_frac = (double)px / (plot_w - 1);
-                    double t_target = tmin + t_frac * (tmax - tmin);
-                    int ti = 0;
-                    double bdt = fabs(thc->times[0] - t_target);
-                    for (int i = 1; i < thc->ntimes; i++) {
-                        double dt = fabs(thc->times[i] - t_target);
-                        if (dt < bdt) { bdt = dt; ti = i; }
-                    }
-                    double v = thc->contour_data[ti * thc->nz + zi];
-                    double t = (v - vmin) / (vmax - vmin);
-                    if (t < 0.0) t = 0.0; if (t > 1.0) t = 1.0;
-                    RGB rgb = viridis_colormap(t);
-                    unsigned long px_col = ((unsigned long)(rgb.r)<<16)|
-                                           ((unsigned long)(rgb.g)<<8)|(rgb.b);
-                    XPutPixel(img, px, py, px_col);
+    static SharedImage contour_image;
+    if (shared_image_reserve(&contour_image, dpy, plot_w, plot_h) == 0) {
+        XImage *img = contour_image.image;
+        for (int py = 0; py < plot_h; py++) {
+            /* Map pixel row → z (top=zmax, bottom=zmin) */
+            double z_frac = 1.0 - (double)py / (plot_h - 1);
+            double z_target = zmin + z_frac * (zmax - zmin);
+            /* Find nearest z index */
+            int zi = 0;
+            double best = fabs(thc->z_values[0] - z_target);
+            for (int i = 1; i < thc->nz; i++) {
+                double d = fabs(thc->z_values[i] - z_target);
+                if (d < best) { best = d; zi = i; }
+            }
+            for (int px = 0; px < plot_w; px++) {
+                /* Map pixel col → time index */
+                double t_frac = (double)px / (plot_w - 1);
+                double t_target = tmin + t_frac * (tmax - tmin);
+                int ti = 0;
+                double bdt = fabs(thc->times[0] - t_target);
+                for (int i = 1; i < thc->ntimes; i++) {
+                    double dt = fabs(thc->times[i] - t_target);
+                    if (dt < bdt) { bdt = dt; ti = i; }
                 }
+                double v = thc->contour_data[ti * thc->nz + zi];
+                double t = (v - vmin) / (vmax - vmin);
+                if (t < 0.0) t = 0.0; if (t > 1.0) t = 1.0;
+                RGB rgb = viridis_colormap(t);
+                unsigned long px_col = ((unsigned long)(rgb.r)<<16)|
+                                       ((unsigned long)(rgb.g)<<8)|(rgb.b);
+                XPutPixel(img, px, py, px_col);
             }
-            XPutImage(dpy, win, gc2, img, 0, 0, plot_left, plot_top, plot_w, plot_h);
-            free(img->data); img->data = NULL;
         }
-        XDestroyImage(img);
+        shared_image_put(&contour_image, win, gc2, plot_left, plot_top, plot_w, plot_h);
     }
 
     /* Axes */
@@ -6406,29 +10064,18 @@ void show_time_height_contour(PlotfileData *pf) {
         tmp_pf.current_level = 0;
 
         if (read_header(&tmp_pf) < 0)        { thc->times[ti] = ti; continue; }
-        if (read_cell_h(&tmp_pf) < 0)        { thc->times[ti] = tmp_pf.time; continue; }
-        if (read_variable_data(&tmp_pf, var_idx) < 0) { thc->times[ti] = tmp_pf.time; continue; }
-
         thc->times[ti] = tmp_pf.time;
 
-        int tnx = tmp_pf.grid_dims[0];
-        int tny = tmp_pf.grid_dims[1];
+        /* Horizontal means are the z planes of this timestep's own index */
+        const Moments *z_planes = NULL;
+        if (read_cell_h(&tmp_pf) == 0 && read_variable_data(&tmp_pf, var_idx) == 0) {
+            z_planes = plane_index_lookup(&tmp_pf, 2);
+        }
         int tnz = tmp_pf.grid_dims[2];
-        int use_nz = (tnz < nz) ? tnz : nz;
+        int use_nz = z_planes ? ((tnz < nz) ? tnz : nz) : 0;
 
         for (int k = 0; k < use_nz; k++) {
-            double sum = 0.0;
-            long count = 0;
-            for (int j = 0; j < tny; j++) {
-                for (int i = 0; i < tnx; i++) {
-                    long idx = (long)k * tnx * tny + (long)j * tnx + i;
-                    if (idx < (long)tnx * tny * tnz) {
-                        sum += tmp_pf.data[idx];
-                        count++;
-                    }
-                }
-            }
-            double mean_val = (count > 0) ? sum / count : 0.0;
+            double mean_val = moments_mean(&z_planes[k]);
             thc->contour_data[ti * nz + k] = mean_val;
             if (mean_val < thc->vmin) thc->vmin = mean_val;
             if (mean_val > thc->vmax) thc->vmax = mean_val;
@@ -6437,7 +10084,8 @@ void show_time_height_contour(PlotfileData *pf) {
         for (int k = use_nz; k < nz; k++)
             thc->contour_data[ti * nz + k] = 0.0;
 
-        if (tmp_pf.data) { free(tmp_pf.data); tmp_pf.data = NULL; }
+        release_variable_data(&tmp_pf);
+        free_box_tables(&tmp_pf);
     }
 
     /* Restore original state */
@@ -7209,8 +10857,9 @@ void compute_distribution_data(DistributionPopupData *popup, int mode) {
     if (popup->bin_counts) { free(popup->bin_counts); popup->bin_counts = NULL; }
     if (popup->bin_centers) { free(popup->bin_centers); popup->bin_centers = NULL; }
 
-    int data_size;
-    double *data_array;
+    size_t data_size;
+    double *data_array = NULL;     /* Gathered layer; the domain is used in place */
+    const double *values;
 
     if (mode == 0) {
         /* Layer mode: extract slice */
@@ -7225,65 +10874,54 @@ void compute_distribution_data(DistributionPopupData *popup, int mode) {
             slice_dim1 = pf->grid_dims[1];
             slice_dim2 = pf->grid_dims[2];
         }
-        data_size = slice_dim1 * slice_dim2;
+        data_size = (size_t)slice_dim1 * slice_dim2;
         data_array = (double *)malloc(data_size * sizeof(double));
+        if (!data_array) return;
 
-        int k = 0;
+        size_t k = 0;
         for (int j = 0; j < slice_dim2; j++) {
             for (int i = 0; i < slice_dim1; i++) {
-                int idx;
+                size_t idx;
+                size_t nx = pf->grid_dims[0], nxy = nx * pf->grid_dims[1];
                 if (axis == 2) {
-                    idx = slice_idx * pf->grid_dims[0] * pf->grid_dims[1] + j * pf->grid_dims[0] + i;
+                    idx = slice_idx * nxy + j * nx + i;
                 } else if (axis == 1) {
-                    idx = j * pf->grid_dims[0] * pf->grid_dims[1] + slice_idx * pf->grid_dims[0] + i;
+                    idx = j * nxy + slice_idx * nx + i;
                 } else {
-                    idx = j * pf->grid_dims[0] * pf->grid_dims[1] + i * pf->grid_dims[0] + slice_idx;
+                    idx = j * nxy + i * nx + slice_idx;
                 }
                 data_array[k++] = pf->data[idx];
             }
         }
+        values = data_array;
 
         snprintf(popup->title, sizeof(popup->title), "%s Distribution - %s Layer %d (Level %d)",
                  pf->variables[pf->current_var], axis_names[axis], slice_idx + 1, pf->current_level);
     } else {
         /* Domain mode: use entire domain */
-        data_size = pf->grid_dims[0] * pf->grid_dims[1] * pf->grid_dims[2];
-        data_array = (double *)malloc(data_size * sizeof(double));
-        for (int i = 0; i < data_size; i++) {
-            data_array[i] = pf->data[i];
-        }
+        data_size = (size_t)pf->grid_dims[0] * pf->grid_dims[1] * pf->grid_dims[2];
+        values = pf->data;
 
         snprintf(popup->title, sizeof(popup->title), "%s Distribution - Entire Domain (Level %d)",
                  pf->variables[pf->current_var], pf->current_level);
     }
 
-    /* Calculate statistics */
-    double sum = 0.0, sum_sq = 0.0;
-    double data_min = 1e30, data_max = -1e30;
-
-    for (int i = 0; i < data_size; i++) {
-        double val = data_array[i];
-        sum += val;
-        sum_sq += val * val;
-        if (val < data_min) data_min = val;
-        if (val > data_max) data_max = val;
-    }
-
-    double mean = sum / data_size;
-    double variance = (sum_sq / data_size) - (mean * mean);
-    double std = (variance > 0) ? sqrt(variance) : 0.0;
-
-    /* Calculate skewness */
-    double sum_third = 0.0;
-    for (int i = 0; i < data_size; i++) {
-        double diff = data_array[i] - mean;
-        sum_third += diff * diff * diff;
-    }
-    double skewness = 0.0;
-    if (std > 0) {
-        double std3 = std * std * std;
-        skewness = (sum_third / data_size) / std3;
+    /* Statistics from the plane index (the domain is all z planes), or
+     * computed in one pass */
+    Moments mom;
+    const Moments *planes = plane_index_lookup(pf, mode == 0 ? axis : 2);
+    if (planes && mode == 0) {
+        mom = planes[slice_idx];
+    } else if (planes) {
+        moments_init(&mom);
+        for (int k = 0; k < pf->grid_dims[2]; k++) moments_merge(&mom, &planes[k]);
+    } else {
+        moments_compute(values, data_size, &mom);
     }
+    double data_min = mom.min, data_max = mom.max;
+    double mean = moments_mean(&mom);
+    double std = moments_std(&mom);
+    double skewness = moments_skewness(&mom);
 
     /* Determine number of bins using Sturges' rule */
     int n_bins = (int)(1 + 3.322 * log10((double)data_size));
@@ -7301,8 +10939,8 @@ void compute_distribution_data(DistributionPopupData *popup, int mode) {
     }
 
     /* Count values in each bin */
-    for (int i = 0; i < data_size; i++) {
-        int bin = (int)((data_array[i] - data_min) / bin_width);
+    for (size_t i = 0; i < data_size; i++) {
+        int bin = (int)((values[i] - data_min) / bin_width);
         if (bin < 0) bin = 0;
         if (bin >= n_bins) bin = n_bins - 1;
         bin_counts[bin]++;
@@ -8298,24 +11936,179 @@ void variable_selector_close_callback(Widget w, XtPointer client_data, XtPointer
     }
 }
 
-/* Draw an arrow from (x1,y1) to (x2,y2) */
-void draw_arrow(Display *dpy, Drawable win, GC graphics_gc, int x1, int y1, int x2, int y2) {
-    /* Draw main line */
-    XDrawLine(dpy, win, graphics_gc, x1, y1, x2, y2);
-    
-    /* Calculate arrow head */
-    double angle = atan2(y2 - y1, x2 - x1);
-    double head_len = 4.0;  /* Arrow head length */
-    double head_angle = 0.5;  /* Arrow head angle */
-    
-    int head_x1 = x2 - (int)(head_len * cos(angle - head_angle));
-    int head_y1 = y2 - (int)(head_len * sin(angle - head_angle));
-    int head_x2 = x2 - (int)(head_len * cos(angle + head_angle));
-    int head_y2 = y2 - (int)(head_len * sin(angle + head_angle));
-    
-    /* Draw arrow head */
-    XDrawLine(dpy, win, graphics_gc, x2, y2, head_x1, head_y1);
-    XDrawLine(dpy, win, graphics_gc, x2, y2, head_x2, head_y2);
+/* Arrows of one quiver frame as structure-of-arrays: tail (x0, y0) and
+ * tip (x1, y1) in pixels, plus the ends of the two head strokes once
+ * arrow_heads has run. The arrays live in one block reused across frames. */
+typedef struct {
+    int *x0, *y0, *x1, *y1;
+    int *hx1, *hy1, *hx2, *hy2;
+    int n, cap;
+} ArrowBatch;
+
+static ArrowBatch quiver_arrows;
+
+static int arrow_batch_reserve(ArrowBatch *b, int n) {
+    b->n = 0;
+    if (n <= b->cap) return 0;
+    int *block = (int *)realloc(b->x0, (size_t)8 * n * sizeof(int));
+    if (!block) return -1;
+    b->x0 = block;
+    b->y0 = block + n;
+    b->x1 = block + 2 * (size_t)n;
+    b->y1 = block + 3 * (size_t)n;
+    b->hx1 = block + 4 * (size_t)n;
+    b->hy1 = block + 5 * (size_t)n;
+    b->hx2 = block + 6 * (size_t)n;
+    b->hy2 = block + 7 * (size_t)n;
+    b->cap = n;
+    return 0;
+}
+
+/* Head stroke ends of every arrow, in one branch-free stride-1 pass (four
+ * arrows at a time with AVX2): each stroke points back along the shaft,
+ * rotated by -/+ the head angle */
+static void arrow_heads(ArrowBatch *b) {
+    const double head_len = 4.0;        /* Arrow head length */
+    const double cos_h = 0.87758256189037276;   /* cos(0.5), head angle */
+    const double sin_h = 0.47942553860420301;   /* sin(0.5) */
+    const int *x0 = b->x0, *y0 = b->y0, *x1 = b->x1, *y1 = b->y1;
+    int *hx1 = b->hx1, *hy1 = b->hy1, *hx2 = b->hx2, *hy2 = b->hy2;
+    int k = 0, n = b->n;
+
+#if defined(__AVX2__)
+    const __m256d hc = _mm256_set1_pd(head_len * cos_h), hs = _mm256_set1_pd(head_len * sin_h);
+    const __m256d one = _mm256_set1_pd(1.0), zero = _mm256_setzero_pd();
+    for (; k + 4 <= n; k += 4) {
+        __m128i tx = _mm_loadu_si128((const __m128i *)(x1 + k));
+        __m128i ty = _mm_loadu_si128((const __m128i *)(y1 + k));
+        __m256d dx = _mm256_cvtepi32_pd(_mm_sub_epi32(tx, _mm_loadu_si128((const __m128i *)(x0 + k))));
+        __m256d dy = _mm256_cvtepi32_pd(_mm_sub_epi32(ty, _mm_loadu_si128((const __m128i *)(y0 + k))));
+        __m256d len = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+        __m256d has = _mm256_cmp_pd(len, zero, _CMP_GT_OQ);
+        __m256d l = _mm256_blendv_pd(one, len, has);
+        __m256d ca = _mm256_blendv_pd(one, _mm256_div_pd(dx, l), has);
+        __m256d sa = _mm256_div_pd(dy, l);
+        /* head_len * (ca cos_h +/- sa sin_h) etc., truncated like (int) */
+        __m256d cc = _mm256_mul_pd(ca, hc), ss = _mm256_mul_pd(sa, hs);
+        __m256d sc = _mm256_mul_pd(sa, hc), cs = _mm256_mul_pd(ca, hs);
+        _mm_storeu_si128((__m128i *)(hx1 + k),
+                         _mm_sub_epi32(tx, _mm256_cvttpd_epi32(_mm256_add_pd(cc, ss))));
+        _mm_storeu_si128((__m128i *)(hy1 + k),
+                         _mm_sub_epi32(ty, _mm256_cvttpd_epi32(_mm256_sub_pd(sc, cs))));
+        _mm_storeu_si128((__m128i *)(hx2 + k),
+                         _mm_sub_epi32(tx, _mm256_cvttpd_epi32(_mm256_sub_pd(cc, ss))));
+        _mm_storeu_si128((__m128i *)(hy2 + k),
+                         _mm_sub_epi32(ty, _mm256_cvttpd_epi32(_mm256_add_pd(sc, cs))));
+    }
+#endif
+    for (; k < n; k++) {
+        double dx = x1[k] - x0[k], dy = y1[k] - y0[k];
+        double len = sqrt(dx * dx + dy * dy);
+        double l = len > 0 ? len : 1.0;
+        double ca = len > 0 ? dx / l : 1.0, sa = dy / l;
+        hx1[k] = x1[k] - (int)(head_len * (ca * cos_h + sa * sin_h));
+        hy1[k] = y1[k] - (int)(head_len * (sa * cos_h - ca * sin_h));
+        hx2[k] = x1[k] - (int)(head_len * (ca * cos_h - sa * sin_h));
+        hy2[k] = y1[k] - (int)(head_len * (sa * cos_h + ca * sin_h));
+    }
+}
+
+/* Pack the shaft and two head strokes of every arrow into segs (three per
+ * arrow, the layout XDrawSegments wants); returns the number of segments */
+static int arrow_segments(XSegment *segs, const ArrowBatch *b) {
+    int k;
+
+    for (k = 0; k < b->n; k++, segs += 3) {
+        segs[0].x1 = b->x0[k]; segs[0].y1 = b->y0[k]; segs[0].x2 = b->x1[k]; segs[0].y2 = b->y1[k];
+        segs[1].x1 = b->x1[k]; segs[1].y1 = b->y1[k]; segs[1].x2 = b->hx1[k]; segs[1].y2 = b->hy1[k];
+        segs[2].x1 = b->x1[k]; segs[2].y1 = b->y1[k]; segs[2].x2 = b->hx2[k]; segs[2].y2 = b->hy2[k];
+    }
+    return 3 * b->n;
+}
+
+/* Quiver components of the displayed plane, kept across redraws (pan,
+ * zoom, colormap, hover) and revalidated by the Cell_H mtime */
+static struct {
+    char plotfile_dir[MAX_PATH];
+    int level, axis, slice_idx;
+    int x_var, y_var;
+    int width, height;
+    time_t stamp;
+    double *u, *v;
+    double max_mag;             /* Largest |(u, v)| on the plane */
+} quiver_slices;
+
+static XSegment *quiver_segs;
+static int cap_quiver_segs;
+
+/* Point quiver_slices at the current plane. On a miss the planes are cut
+ * from the component volumes, which are read in one sweep and left in the
+ * variable cache when they fit half of its budget, so stepping through
+ * layers stays in memory; otherwise just the plane is read. */
+static int quiver_slices_update(PlotfileData *pf, int width, int height) {
+    int x_var = quiver_data.x_comp_index, y_var = quiver_data.y_comp_index;
+    time_t stamp = level_cell_h_stamp(pf->plotfile_dir, pf->current_level);
+    size_t k, n = (size_t)width * height;
+    size_t bytes = (size_t)pf->grid_dims[0] * pf->grid_dims[1] * pf->grid_dims[2] * sizeof(double);
+    int n_comps = x_var == y_var ? 1 : 2;
+
+    if (quiver_slices.u && quiver_slices.level == pf->current_level &&
+        quiver_slices.axis == pf->slice_axis && quiver_slices.slice_idx == pf->slice_idx &&
+        quiver_slices.x_var == x_var && quiver_slices.y_var == y_var &&
+        quiver_slices.width == width && quiver_slices.height == height &&
+        quiver_slices.stamp == stamp &&
+        strcmp(quiver_slices.plotfile_dir, pf->plotfile_dir) == 0) {
+        return 0;
+    }
+
+    free(quiver_slices.u);
+    free(quiver_slices.v);
+    memset(&quiver_slices, 0, sizeof(quiver_slices));
+    double *u = (double *)malloc(n * sizeof(double));
+    double *v = (double *)malloc(n * sizeof(double));
+    if (!u || !v) {
+        free(u);
+        free(v);
+        return -1;
+    }
+
+    int comp_vars[2] = { x_var, y_var };
+    double *comp_slices[2] = { u, v };
+    if (n_comps * bytes <= var_cache_budget() / 2) {
+        double *vols[2] = { NULL, NULL };
+        int c;
+        read_variables_data(pf, comp_vars, n_comps, vols);
+        for (c = 0; c < n_comps; c++) {
+            if (vols[c]) extract_plane(vols[c], pf->grid_dims, pf->slice_axis, pf->slice_idx,
+                                       comp_slices[c]);
+            else memset(comp_slices[c], 0, n * sizeof(double));
+            var_cache_release(vols[c]);
+        }
+    } else {
+        read_variable_slices(pf, comp_vars, n_comps, pf->slice_axis, pf->slice_idx, comp_slices);
+    }
+    if (n_comps == 1) memcpy(v, u, n * sizeof(double));
+
+    double max_mag2 = 0.0;
+    for (k = 0; k < n; k++) {
+        double mag2 = u[k] * u[k] + v[k] * v[k];
+        if (mag2 > max_mag2) max_mag2 = mag2;
+    }
+
+    strncpy(quiver_slices.plotfile_dir, pf->plotfile_dir, MAX_PATH - 1);
+    quiver_slices.plotfile_dir[MAX_PATH - 1] = '\0';
+    quiver_slices.level = pf->current_level;
+    quiver_slices.axis = pf->slice_axis;
+    quiver_slices.slice_idx = pf->slice_idx;
+    quiver_slices.x_var = x_var;
+    quiver_slices.y_var = y_var;
+    quiver_slices.width = width;
+    quiver_slices.height = height;
+    quiver_slices.stamp = stamp;
+    quiver_slices.u = u;
+    quiver_slices.v = v;
+    quiver_slices.max_mag = sqrt(max_mag2);
+    return 0;
 }
 
 /* Render quiver overlay */
@@ -8337,93 +12130,45 @@ void render_quiver_overlay(PlotfileData *pf) {
         height = pf->grid_dims[2];
     }
     
-    /* Read component data */
-    double *x_comp_data = (double *)malloc(pf->grid_dims[0] * pf->grid_dims[1] * pf->grid_dims[2] * sizeof(double));
-    double *y_comp_data = (double *)malloc(pf->grid_dims[0] * pf->grid_dims[1] * pf->grid_dims[2] * sizeof(double));
-    
-    /* Save current variable and read component data */
-    int saved_var = pf->current_var;
-    
-    pf->current_var = quiver_data.x_comp_index;
-    read_variable_data(pf, quiver_data.x_comp_index);
-    memcpy(x_comp_data, pf->data, pf->grid_dims[0] * pf->grid_dims[1] * pf->grid_dims[2] * sizeof(double));
-    
-    pf->current_var = quiver_data.y_comp_index;
-    read_variable_data(pf, quiver_data.y_comp_index);
-    memcpy(y_comp_data, pf->data, pf->grid_dims[0] * pf->grid_dims[1] * pf->grid_dims[2] * sizeof(double));
-    
-    /* Restore original variable */
-    pf->current_var = saved_var;
-    read_variable_data(pf, saved_var);
-    
-    /* Extract slices for both components */
-    double *x_slice = (double *)malloc(width * height * sizeof(double));
-    double *y_slice = (double *)malloc(width * height * sizeof(double));
-    
-    extract_slice_from_data(x_comp_data, pf, x_slice, pf->slice_axis, pf->slice_idx);
-    extract_slice_from_data(y_comp_data, pf, y_slice, pf->slice_axis, pf->slice_idx);
+    /* Component planes, from memory unless the plane changed */
+    if (quiver_slices_update(pf, width, height) < 0) return;
+    const double *x_slice = quiver_slices.u;
+    const double *y_slice = quiver_slices.v;
+    double max_mag = quiver_slices.max_mag;
 
     /* Map coordinates when map mode is enabled */
     int use_map_coords = 0;
-    double *x_coord_slice = NULL;
-    double *y_coord_slice = NULL;
+    const double *x_coord_slice = NULL;
+    const double *y_coord_slice = NULL;
     if (pf->map_mode && map_has_bounds) {
         int lon_idx = find_variable_index(pf, "lon_m");
         int lat_idx = find_variable_index(pf, "lat_m");
         if (lon_idx >= 0 && lat_idx >= 0) {
-            x_coord_slice = (double *)malloc(width * height * sizeof(double));
-            y_coord_slice = (double *)malloc(width * height * sizeof(double));
-
+            /* Same planes render_slice placed the cells with (cache hits) */
+            double dz = (pf->prob_hi[2] - pf->prob_lo[2]) / pf->grid_dims[2];
+            const GeoSlice *geo;
             if (pf->slice_axis == 2) {
                 /* Z-slice: lon/lat */
-                read_variable_data(pf, lon_idx);
-                extract_slice_from_data(pf->data, pf, x_coord_slice, pf->slice_axis, pf->slice_idx);
-                read_variable_data(pf, lat_idx);
-                extract_slice_from_data(pf->data, pf, y_coord_slice, pf->slice_axis, pf->slice_idx);
+                geo = geo_slice_get(pf, pf->current_level, lon_idx, lat_idx, pf->slice_axis,
+                                    pf->slice_idx, width, height, 0.0, 0.0);
             } else if (pf->slice_axis == 1) {
                 /* Y-slice: lon vs Z */
-                read_variable_data(pf, lon_idx);
-                extract_slice_from_data(pf->data, pf, x_coord_slice, pf->slice_axis, pf->slice_idx);
-                for (int jj = 0; jj < height; jj++) {
-                    for (int ii = 0; ii < width; ii++) {
-                        int idx = jj * width + ii;
-                        double z_coord = pf->prob_lo[2] + (jj + 0.5) * (pf->prob_hi[2] - pf->prob_lo[2]) / pf->grid_dims[2];
-                        y_coord_slice[idx] = z_coord;
-                    }
-                }
+                geo = geo_slice_get(pf, pf->current_level, lon_idx, -1, pf->slice_axis,
+                                    pf->slice_idx, width, height, pf->prob_lo[2], dz);
             } else {
                 /* X-slice: lat vs Z */
-                read_variable_data(pf, lat_idx);
-                extract_slice_from_data(pf->data, pf, x_coord_slice, pf->slice_axis, pf->slice_idx);
-                for (int jj = 0; jj < height; jj++) {
-                    for (int ii = 0; ii < width; ii++) {
-                        int idx = jj * width + ii;
-                        double z_coord = pf->prob_lo[2] + (jj + 0.5) * (pf->prob_hi[2] - pf->prob_lo[2]) / pf->grid_dims[2];
-                        y_coord_slice[idx] = z_coord;
-                    }
-                }
+                geo = geo_slice_get(pf, pf->current_level, lat_idx, -1, pf->slice_axis,
+                                    pf->slice_idx, width, height, pf->prob_lo[2], dz);
+            }
+            if (geo) {
+                x_coord_slice = geo->x;
+                y_coord_slice = geo->y;
+                use_map_coords = 1;
             }
-
-            /* Restore current variable */
-            read_variable_data(pf, saved_var);
-            use_map_coords = 1;
         }
     }
     
-    /* Find max magnitude for scaling */
-    double max_mag = 0.0;
-    for (int i = 0; i < width * height; i++) {
-        double mag = sqrt(x_slice[i] * x_slice[i] + y_slice[i] * y_slice[i]);
-        if (mag > max_mag) max_mag = mag;
-    }
-    
-    if (max_mag == 0.0) {
-        free(x_comp_data);
-        free(y_comp_data);
-        free(x_slice);
-        free(y_slice);
-        return;
-    }
+    if (max_mag == 0.0) return;
     
     /* Set up drawing parameters */
     unsigned long arrow_color;
@@ -8449,6 +12194,24 @@ void render_quiver_overlay(PlotfileData *pf) {
     }
     
     double scale = 15.0 * quiver_data.scale;  /* User-controlled arrow scale */
+
+    /* Room for one arrow, and three segments, per sampled cell */
+    int n_cols = (width - skip / 2 + skip - 1) / skip;
+    int n_rows = (height - skip / 2 + skip - 1) / skip;
+    if (n_cols <= 0 || n_rows <= 0) return;
+    size_t need = (size_t)n_cols * n_rows * 3;
+    if (need > (size_t)cap_quiver_segs) {
+        XSegment *tmp = (XSegment *)realloc(quiver_segs, need * sizeof(XSegment));
+        if (!tmp) return;
+        quiver_segs = tmp;
+        cap_quiver_segs = (int)need;
+    }
+    ArrowBatch *arrows = &quiver_arrows;
+    if (arrow_batch_reserve(arrows, n_cols * n_rows) < 0) return;
+
+    /* Screen mapping of map coordinates */
+    double map_sx = render_width / (map_last_lon_max - map_last_lon_min);
+    double map_sy = render_height / (map_last_lat_max - map_last_lat_min);
     
     for (int j = skip/2; j < height; j += skip) {
         for (int i = skip/2; i < width; i += skip) {
@@ -8467,10 +12230,8 @@ void render_quiver_overlay(PlotfileData *pf) {
                     y_coord < map_last_lat_min || y_coord > map_last_lat_max) {
                     continue;
                 }
-                screen_x = render_offset_x + (int)((x_coord - map_last_lon_min) /
-                                                  (map_last_lon_max - map_last_lon_min) * render_width);
-                screen_y = render_offset_y + (int)((map_last_lat_max - y_coord) /
-                                                  (map_last_lat_max - map_last_lat_min) * render_height);
+                screen_x = render_offset_x + (int)((x_coord - map_last_lon_min) * map_sx);
+                screen_y = render_offset_y + (int)((map_last_lat_max - y_coord) * map_sy);
 
                 int i_prev = (i > 0) ? i - 1 : i;
                 int i_next = (i + 1 < width) ? i + 1 : i;
@@ -8483,37 +12244,11 @@ void render_quiver_overlay(PlotfileData *pf) {
                 int idx_j_prev = j_prev * width + i;
                 int idx_j_next = j_next * width + i;
 
-                double xi_prev = x_coord_slice[idx_i_prev];
-                double yi_prev = y_coord_slice[idx_i_prev];
-                double xi_next = x_coord_slice[idx_i_next];
-                double yi_next = y_coord_slice[idx_i_next];
-                double xj_prev = x_coord_slice[idx_j_prev];
-                double yj_prev = y_coord_slice[idx_j_prev];
-                double xj_next = x_coord_slice[idx_j_next];
-                double yj_next = y_coord_slice[idx_j_next];
-
-                int sx_i_prev = render_offset_x + (int)((xi_prev - map_last_lon_min) /
-                                                       (map_last_lon_max - map_last_lon_min) * render_width);
-                int sy_i_prev = render_offset_y + (int)((map_last_lat_max - yi_prev) /
-                                                       (map_last_lat_max - map_last_lat_min) * render_height);
-                int sx_i_next = render_offset_x + (int)((xi_next - map_last_lon_min) /
-                                                       (map_last_lon_max - map_last_lon_min) * render_width);
-                int sy_i_next = render_offset_y + (int)((map_last_lat_max - yi_next) /
-                                                       (map_last_lat_max - map_last_lat_min) * render_height);
-
-                int sx_j_prev = render_offset_x + (int)((xj_prev - map_last_lon_min) /
-                                                       (map_last_lon_max - map_last_lon_min) * render_width);
-                int sy_j_prev = render_offset_y + (int)((map_last_lat_max - yj_prev) /
-                                                       (map_last_lat_max - map_last_lat_min) * render_height);
-                int sx_j_next = render_offset_x + (int)((xj_next - map_last_lon_min) /
-                                                       (map_last_lon_max - map_last_lon_min) * render_width);
-                int sy_j_next = render_offset_y + (int)((map_last_lat_max - yj_next) /
-                                                       (map_last_lat_max - map_last_lat_min) * render_height);
-
-                double basis_ix = 0.5 * (sx_i_next - sx_i_prev);
-                double basis_iy = 0.5 * (sy_i_next - sy_i_prev);
-                double basis_jx = 0.5 * (sx_j_next - sx_j_prev);
-                double basis_jy = 0.5 * (sy_j_next - sy_j_prev);
+                /* Local grid directions on screen */
+                double basis_ix = 0.5 * (x_coord_slice[idx_i_next] - x_coord_slice[idx_i_prev]) * map_sx;
+                double basis_iy = -0.5 * (y_coord_slice[idx_i_next] - y_coord_slice[idx_i_prev]) * map_sy;
+                double basis_jx = 0.5 * (x_coord_slice[idx_j_next] - x_coord_slice[idx_j_prev]) * map_sx;
+                double basis_jy = -0.5 * (y_coord_slice[idx_j_next] - y_coord_slice[idx_j_prev]) * map_sy;
 
                 double mag_i = sqrt(basis_ix * basis_ix + basis_iy * basis_iy);
                 double mag_j = sqrt(basis_jx * basis_jx + basis_jy * basis_jy);
@@ -8537,18 +12272,18 @@ void render_quiver_overlay(PlotfileData *pf) {
                 arrow_dy = (int)(-v * scale);  /* Flip Y to match screen coordinates */
             }
             
-            draw_arrow(display, canvas, gc, screen_x, screen_y, 
-                      screen_x + arrow_dx, screen_y + arrow_dy);
+            arrows->x0[arrows->n] = screen_x - layer_dx;
+            arrows->y0[arrows->n] = screen_y - layer_dy;
+            arrows->x1[arrows->n] = screen_x + arrow_dx - layer_dx;
+            arrows->y1[arrows->n] = screen_y + arrow_dy - layer_dy;
+            arrows->n++;
         }
     }
-    
-    /* Cleanup */
-    free(x_comp_data);
-    free(y_comp_data);
-    free(x_slice);
-    free(y_slice);
-    if (x_coord_slice) free(x_coord_slice);
-    if (y_coord_slice) free(y_coord_slice);
+
+    /* Heads for all arrows at once, then every segment in one request batch */
+    arrow_heads(arrows);
+    int n_segs = arrow_segments(quiver_segs, arrows);
+    if (n_segs > 0) XDrawSegments(display, pan_cache, gc, quiver_segs, n_segs);
 }
 
 /* Render map overlay with US coastline */
@@ -8654,7 +12389,7 @@ static int draw_geojson_coastline(const char *path, double lon_min, double lon_m
                                 int y1 = offset_y + (int)((lat_max - prev_lat) / (lat_max - lat_min) * render_h);
                                 int x2 = offset_x + (int)((lon - lon_min) / (lon_max - lon_min) * render_w);
                                 int y2 = offset_y + (int)((lat_max - lat) / (lat_max - lat_min) * render_h);
-                                XDrawLine(display, canvas, coastline_gc, x1, y1, x2, y2);
+                                XDrawLine(display, pan_cache, coastline_gc, x1, y1, x2, y2);
                             }
                         }
                     }
@@ -8687,12 +12422,6 @@ void render_map_overlay(PlotfileData *pf, double lon_min, double lon_max, double
     XSetForeground(display, coastline_gc, map_color_pixel);
     XSetLineAttributes(display, coastline_gc, 3, LineSolid, CapButt, JoinMiter);  /* Thick line for visibility */
 
-    /* Apply zoom clip to coastline GC */
-    if (zoom_level > 1.0) {
-        XRectangle clip = {vis_area_x, vis_area_y, vis_area_w, vis_area_h};
-        XSetClipRectangles(display, coastline_gc, 0, 0, &clip, 1, Unsorted);
-    }
-    
     if (!map_coastlines_enabled) {
         XFreeGC(display, coastline_gc);
         return;
@@ -8704,8 +12433,10 @@ void render_map_overlay(PlotfileData *pf, double lon_min, double lon_max, double
     for (int i = 0; i < n_coastlines; i++) {
         CoastlineEntry *ce = &coastlines[i];
         if (!ce->enabled) continue;
+        /* Coastlines go into the pan cache, whose origin is (layer_dx, layer_dy) */
         if (draw_geojson_coastline(ce->filename, lon_min, lon_max, lat_min, lat_max,
-                                   render_offset_x, render_offset_y, render_width, render_height,
+                                   render_offset_x - layer_dx, render_offset_y - layer_dy,
+                                   render_width, render_height,
                                    coastline_gc)) {
             drew_any = 1;
         }
@@ -8803,7 +12534,7 @@ void show_time_series(PlotfileData *pf) {
         slice_dim1 = pf->grid_dims[1];
         slice_dim2 = pf->grid_dims[2];
     }
-    int slice_size = slice_dim1 * slice_dim2;
+    size_t slice_size = (size_t)slice_dim1 * slice_dim2;
 
     /* Allocate arrays for time series statistics */
     double *means = (double *)malloc(n_timesteps * sizeof(double));
@@ -8811,80 +12542,45 @@ void show_time_series(PlotfileData *pf) {
     double *skewness = (double *)malloc(n_timesteps * sizeof(double));
     double *time_indices = (double *)malloc(n_timesteps * sizeof(double));
 
+    double *slice = (double *)malloc(slice_size * sizeof(double));
+
+    const Moments *current_planes = plane_index_lookup(pf, axis);
+
     printf("Computing time series statistics for %d timesteps...\n", n_timesteps);
 
     /* Loop through all timesteps */
     for (int t = 0; t < n_timesteps; t++) {
         time_indices[t] = t + 1;  /* 1-indexed for display */
 
-        /* Load this timestep's data */
-        strncpy(pf->plotfile_dir, timestep_paths[t], MAX_PATH - 1);
-        read_header(pf);
-        pf->n_boxes = 0;
-        read_cell_h(pf);
-        read_variable_data(pf, current_var);
-
-        /* Calculate statistics for the slice */
-        double sum = 0.0, sum_sq = 0.0;
-
-        for (int j = 0; j < slice_dim2; j++) {
-            for (int i = 0; i < slice_dim1; i++) {
-                int idx;
-                if (axis == 2) {
-                    idx = slice_idx * pf->grid_dims[0] * pf->grid_dims[1] + j * pf->grid_dims[0] + i;
-                } else if (axis == 1) {
-                    idx = j * pf->grid_dims[0] * pf->grid_dims[1] + slice_idx * pf->grid_dims[0] + i;
-                } else {
-                    idx = j * pf->grid_dims[0] * pf->grid_dims[1] + i * pf->grid_dims[0] + slice_idx;
-                }
-                double val = pf->data[idx];
-                sum += val;
-                sum_sq += val * val;
-            }
-        }
-
-        means[t] = sum / slice_size;
-        double variance = (sum_sq / slice_size) - (means[t] * means[t]);
-        stds[t] = (variance > 0) ? sqrt(variance) : 0.0;
-
-        /* Second pass: calculate skewness (third moment) */
-        double sum_third = 0.0;
-        for (int j = 0; j < slice_dim2; j++) {
-            for (int i = 0; i < slice_dim1; i++) {
-                int idx;
-                if (axis == 2) {
-                    idx = slice_idx * pf->grid_dims[0] * pf->grid_dims[1] + j * pf->grid_dims[0] + i;
-                } else if (axis == 1) {
-                    idx = j * pf->grid_dims[0] * pf->grid_dims[1] + slice_idx * pf->grid_dims[0] + i;
-                } else {
-                    idx = j * pf->grid_dims[0] * pf->grid_dims[1] + i * pf->grid_dims[0] + slice_idx;
-                }
-                double val = pf->data[idx];
-                double diff = val - means[t];
-                sum_third += diff * diff * diff;
-            }
-        }
-
-        /* Skewness = E[(X - mu)^3] / sigma^3 */
-        if (stds[t] > 0) {
-            double std3 = stds[t] * stds[t] * stds[t];
-            skewness[t] = (sum_third / slice_size) / std3;
+        /* The loaded timestep is summarized by the plane index */
+        Moments mom;
+        if (current_planes && t == original_timestep) {
+            mom = current_planes[slice_idx];
         } else {
-            skewness[t] = 0.0;
-        }
+            /* Load only this timestep's slice; pf->data is left untouched */
+            strncpy(pf->plotfile_dir, timestep_paths[t], MAX_PATH - 1);
+            read_header(pf);
+            pf->n_boxes = 0;
+            read_cell_h(pf);
+            read_variable_slice(pf, current_var, axis, slice_idx, slice);
+            moments_compute(slice, slice_size, &mom);
+        }
+        means[t] = moments_mean(&mom);
+        stds[t] = moments_std(&mom);
+        skewness[t] = moments_skewness(&mom);
 
         if ((t + 1) % 10 == 0 || t == n_timesteps - 1) {
             printf("  Processed %d/%d timesteps\n", t + 1, n_timesteps);
         }
     }
+    free(slice);
 
-    /* Restore original state */
+    /* Restore original state (the loaded variable volume was never replaced) */
     strncpy(pf->plotfile_dir, original_dir, MAX_PATH - 1);
     current_timestep = original_timestep;
     read_header(pf);
     pf->n_boxes = 0;
     read_cell_h(pf);
-    read_variable_data(pf, current_var);
 
     /* Create plot data for mean */
     PlotData *mean_plot = (PlotData *)malloc(sizeof(PlotData));
@@ -9006,7 +12702,9 @@ void show_time_series(PlotfileData *pf) {
 }
 
 void cleanup(PlotfileData *pf) {
-    if (pf->data) free(pf->data);
+    prefetch_cancel();
+    release_variable_data(pf);
+    free_box_tables(pf);
     if (pixel_data) free(pixel_data);
     pixel_data_size = 0;
     if (current_slice_data) free(current_slice_data);
@@ -9941,6 +13639,7 @@ int compute_sbm_values(SBMData *sbm, const char *plotfile_dir) {
 
     if (read_cell_h(&pf) < 0) {
         fprintf(stderr, "Error: Failed to read cell header\n");
+        free_box_tables(&pf);
         return -1;
     }
 
@@ -9984,48 +13683,50 @@ int compute_sbm_values(SBMData *sbm, const char *plotfile_dir) {
             break;
     }
 
-    /* Read and sum each bin */
+    /* Gather the components of every bin; both prefixes of a total metric
+     * land in the same bin */
+    int comp_vars[2 * MAX_SBM_BINS], comp_bins[2 * MAX_SBM_BINS];
+    int n_comps = 0;
     for (int bin = 0; bin < sbm->n_bins; bin++) {
-        char varname[64];
-        double total = 0.0;
-
-        /* First component */
-        snprintf(varname, sizeof(varname), "%s%02d", prefix1, bin);
-        int var_idx = find_variable_index(&pf, varname);
-
-        if (var_idx >= 0) {
-            if (read_variable_data(&pf, var_idx) == 0) {
-                /* Sum all grid cells */
-                int total_size = pf.grid_dims[0] * pf.grid_dims[1] * pf.grid_dims[2];
-                for (int i = 0; i < total_size; i++) {
-                    total += pf.data[i];
-                }
+        const char *prefixes[2] = {prefix1, prefix2};
+        for (int p = 0; p < 2 && prefixes[p]; p++) {
+            char varname[64];
+            snprintf(varname, sizeof(varname), "%s%02d", prefixes[p], bin);
+            int var_idx = find_variable_index(&pf, varname);
+            if (var_idx >= 0) {
+                comp_vars[n_comps] = var_idx;
+                comp_bins[n_comps++] = bin;
             }
         }
+    }
 
-        /* Second component (for total metrics) */
-        if (prefix2) {
-            snprintf(varname, sizeof(varname), "%s%02d", prefix2, bin);
-            var_idx = find_variable_index(&pf, varname);
-
-            if (var_idx >= 0) {
-                if (read_variable_data(&pf, var_idx) == 0) {
-                    int total_size = pf.grid_dims[0] * pf.grid_dims[1] * pf.grid_dims[2];
-                    for (int i = 0; i < total_size; i++) {
-                        total += pf.data[i];
-                    }
-                }
+    /* Read the bins in batches, one sweep over the FABs per batch, and sum
+     * all grid cells */
+    size_t total_size = (size_t)pf.grid_dims[0] * pf.grid_dims[1] * pf.grid_dims[2];
+    size_t batch_bytes = (size_t)SBM_READ_BATCH_MB << 20;
+    int batch = (int)(batch_bytes / (total_size * sizeof(double)));
+    if (batch < 1) batch = 1;
+    for (int c0 = 0; c0 < n_comps; c0 += batch) {
+        double *vols[2 * MAX_SBM_BINS];
+        int n = n_comps - c0 < batch ? n_comps - c0 : batch;
+        read_variables_data(&pf, comp_vars + c0, n, vols);
+        for (int c = 0; c < n; c++) {
+            double total = 0.0;
+            if (!vols[c]) continue;
+            for (size_t i = 0; i < total_size; i++) {
+                total += vols[c][i];
             }
+            sbm->bin_values[comp_bins[c0 + c]] += total;
+            var_cache_release(vols[c]);
         }
-
-        sbm->bin_values[bin] = total;
     }
 
     /* Cleanup temporary plotfile data */
     if (pf.data) {
-        free(pf.data);
+        var_cache_release(pf.data);
         pf.data = NULL;
     }
+    free_box_tables(&pf);
 
     return 0;
 }
@@ -10951,12 +14652,10 @@ void draw_profile_contour(Display *dpy, Window win, GC plot_gc, ProfileData *pd,
     double tmin = pf->times[0], tmax = pf->times[pf->ntimes-1];
     if (tmin == tmax) tmax = tmin + 1.0;
 
-    /* Render pixel by pixel using XImage */
-    XImage *img = XCreateImage(dpy, DefaultVisual(dpy, screen), DefaultDepth(dpy, screen),
-                               ZPixmap, 0, NULL, plot_w, plot_h, 32, 0);
-    if (!img) goto draw_axes_only;
-    img->data = (char *)malloc(img->bytes_per_line * plot_h);
-    if (!img->data) { XDestroyImage(img); goto draw_axes_only; }
+    /* Render pixel by pixel into a (shared-memory when possible) XImage */
+    static SharedImage profile_contour_image;
+    if (shared_image_reserve(&profile_contour_image, dpy, plot_w, plot_h) < 0) goto draw_axes_only;
+    XImage *img = profile_contour_image.image;
 
     /* Build lookup: for each pixel column, which time index? */
     /* For each pixel row, which z index (nearest neighbor)? */
@@ -11002,9 +14701,7 @@ void draw_profile_contour(Display *dpy, Window win, GC plot_gc, ProfileData *pd,
             XPutPixel(img, px, py, pixel);
         }
     }
-    XPutImage(dpy, win, plot_gc, img, 0, 0, plot_left, plot_top, plot_w, plot_h);
-    free(img->data); img->data = NULL;
-    XDestroyImage(img);
+    shared_image_put(&profile_contour_image, win, plot_gc, plot_left, plot_top, plot_w, plot_h);
 
 draw_axes_only:
     XSetForeground(dpy, plot_gc, BlackPixel(dpy, screen));
@@ -11363,11 +15060,15 @@ int main(int argc, char **argv) {
             profile_mode = 1;
             for (int j = i; j < argc - 1; j++) argv[j] = argv[j + 1];
             argc--; i--;
+        } else if (strcmp(argv[i], "--cache-mb") == 0 && i + 1 < argc) {
+            set_variable_cache_mb(atol(argv[i + 1]));
+            for (int j = i; j < argc - 2; j++) argv[j] = argv[j + 2];
+            argc -= 2; i--;
         }
     }
 
     if (argc < 2) {
-        fprintf(stderr, "Usage: %s [--sdm|--sbm|--profile] <directory> [prefix]\n", argv[0]);
+        fprintf(stderr, "Usage: %s [--sdm|--sbm|--profile] [--cache-mb N] <directory> [prefix]\n", argv[0]);
         fprintf(stderr, "  Single plotfile:    %s plt00100\n", argv[0]);
         fprintf(stderr, "  Multi-timestep:     %s /path/to/dir plt\n", argv[0]);
         fprintf(stderr, "  With prefix plt2d:  %s /path/to/dir plt2d\n", argv[0]);
@@ -11376,6 +15077,8 @@ int main(int argc, char **argv) {
         fprintf(stderr, "  SBM mode:           %s --sbm plt00100\n", argv[0]);
         fprintf(stderr, "  SBM multi-timestep: %s --sbm /path/to/dir plt\n", argv[0]);
         fprintf(stderr, "  1D Profiles:        %s --profile /path/to/dir\n", argv[0]);
+        fprintf(stderr, "  --cache-mb N:       keep up to N MB of loaded variables in memory (default %d, 0 = off)\n",
+                VAR_CACHE_DEFAULT_MB);
         return 1;
     }
 
@@ -11927,7 +15630,8 @@ int main(int argc, char **argv) {
         /* Handle expose events */
         if (event.type == Expose) {
             if (event.xexpose.window == canvas && global_pf && global_pf->data) {
-                render_slice(global_pf);
+                canvas_repaint(event.xexpose.x, event.xexpose.y,
+                               event.xexpose.width, event.xexpose.height);
                 /* Set keyboard focus on first expose - needed for remote X11 */
                 if (!initial_focus_set) {
                     XSetInputFocus(display, canvas, RevertToParent, CurrentTime);
@@ -23,8 +23,8 @@ def build_c_binary():
             "X11 development libraries not found!\n"
             "Please install:\n"
             "  - macOS: Install XQuartz from https://www.xquartz.org/\n"
-            "  - Debian/Ubuntu: sudo apt-get install libx11-dev libxt-dev libxaw7-dev libxmu-dev\n"
-            "  - RHEL/CentOS: sudo yum install libX11-devel libXt-devel libXaw-devel libXmu-devel"
+            "  - Debian/Ubuntu: sudo apt-get install libx11-dev libxext-dev libxt-dev libxaw7-dev libxmu-dev\n"
+            "  - RHEL/CentOS: sudo yum install libX11-devel libXext-devel libXt-devel libXaw-devel libXmu-devel"
         )
 
     # Determine X11 include and lib paths
@@ -48,7 +48,7 @@ def build_c_binary():
         'gcc', '-O3', '-Wall', '-march=native',
         f'-I{x11_include}',
         '-o', output, 'pltview.c',
-        '-lX11', '-lXt', '-lXaw', '-lXmu', '-lm',
+        '-lX11', '-lXext', '-lXt', '-lXaw', '-lXmu', '-lm', '-lpthread',
         f'-L{x11_lib}'
     ]
 